@@ -0,0 +1,381 @@
+// INSERT, SELECT and ORDER BY (batched odd-even merge and bitonic, shuffle-then-sort and key-only) scaling over row count, column count and field width.
+// Run on three ranks (`cmake --build . --target benchmark`): the client rank drives the workload through
+// SystemManager::clientExecute and prints one JSON array of results, the computing parties serve as usual.
+//
+// SMPC_benchmark [max log2 rows = 20] [max log2 rows of ORDER BY = 16]
+//
+// `SMPC_benchmark check [rows = 300]` (`--target check`) runs WHERE, aggregates, GROUP BY, JOIN and ORDER BY ... LIMIT
+// on random tables under every compaction and sort setting instead, compares each revealed result with the query
+// evaluated on the plaintext and exits with 1 on a mismatch.
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <mpc_package/utils/Comm.h>
+#include <mpc_package/utils/System.h>
+#include <nlohmann/json.hpp>
+
+#include "dbms/SystemManager.h"
+#include "secret/Dealer.h"
+
+using json = nlohmann::json;
+
+static constexpr int MIN_LOG_ROWS = 8;
+static constexpr size_t INSERT_BATCH = 4096;
+static const std::vector<int> COLUMNS = {1, 4};
+static const std::vector<int> WIDTHS = {8, 32, 64};
+
+// wall time and traffic of the commands run by `body`
+static json measure(SystemManager &manager, const std::function<void()> &body) {
+    json before = manager.collectStats();
+    int64_t start = System::currentTimeMillis();
+    body();
+    int64_t ms = System::currentTimeMillis() - start;
+    json after = manager.collectStats();
+
+    uint64_t bytes = 0;
+    for (int r = 0; r < 3; r++) {
+        bytes += after[r].at("bytes").get<uint64_t>() - before[r].at("bytes").get<uint64_t>();
+    }
+    json j;
+    j["ms"] = ms;
+    // sequential rounds seen by computing party 0
+    j["rounds"] = after[0].at("rounds").get<uint64_t>() - before[0].at("rounds").get<uint64_t>();
+    j["bytes"] = bytes;
+    return j;
+}
+
+static void run(SystemManager &manager, const std::string &command) {
+    std::string resp = manager.clientExecute(command);
+    if (resp.starts_with("Failed")) {
+        throw std::runtime_error(command.substr(0, 64) + ": " + resp);
+    }
+}
+
+static json benchmark(SystemManager &manager, int logRows, int columns, int width, bool sort) {
+    size_t rows = 1ULL << logRows;
+    std::string table = "t_" + std::to_string(logRows) + "_" + std::to_string(columns) + "_" + std::to_string(width);
+
+    std::ostringstream create;
+    create << "create table " << table << " (";
+    for (int c = 0; c < columns; c++) {
+        create << (c ? ", " : "") << "c" << c << " int(" << width << ")";
+    }
+    create << ");";
+    run(manager, create.str());
+
+    // statements are generated before timing starts
+    std::mt19937_64 rand(logRows * 131 + columns * 17 + width);
+    int64_t bound = width == 64 ? INT64_MAX : (1LL << (width - 1)) - 1;
+    std::uniform_int_distribution<int64_t> value(-bound, bound);
+    std::vector<std::string> inserts;
+    for (size_t done = 0; done < rows; done += INSERT_BATCH) {
+        std::ostringstream insert;
+        insert << "insert into " << table << " values ";
+        for (size_t r = done; r < std::min(rows, done + INSERT_BATCH); r++) {
+            insert << (r > done ? ", (" : "(");
+            for (int c = 0; c < columns; c++) {
+                insert << (c ? ", " : "") << value(rand);
+            }
+            insert << ")";
+        }
+        inserts.push_back(insert.str() + ";");
+    }
+
+    json results = json::array();
+    auto record = [&](const std::string &name, json j) {
+        j["benchmark"] = name;
+        j["rows"] = rows;
+        j["columns"] = columns;
+        j["width"] = width;
+        j["rows_per_second"] = j.at("ms").get<int64_t>() ? rows * 1000 / j.at("ms").get<int64_t>() : rows * 1000;
+        results.push_back(j);
+    };
+
+    record("insert", measure(manager, [&] {
+        for (const auto &insert: inserts) {
+            run(manager, insert);
+        }
+    }));
+    record("select", measure(manager, [&] {
+        run(manager, "select * from " + table + ";");
+    }));
+    if (sort) {
+        record("order_by", measure(manager, [&] {
+            run(manager, "select * from " + table + " order by c0;");
+        }));
+        record("order_by_bitonic", measure(manager, [&] {
+            run(manager, "set sort_network bitonic;");
+            run(manager, "select * from " + table + " order by c0;");
+            run(manager, "set sort_network odd_even;");
+        }));
+        for (std::string mode: {"shuffle", "key_only"}) {
+            record("order_by_" + mode, measure(manager, [&] {
+                run(manager, "set sort_mode " + mode + ";");
+                run(manager, "select * from " + table + " order by c0;");
+                run(manager, "set sort_mode batched;");
+            }));
+        }
+    }
+
+    run(manager, "drop table " + table + ";");
+    return results;
+}
+
+// plaintext rows of a table inserted by the check
+using Plain = std::vector<std::vector<int64_t> >;
+// rows of a response as printed
+using Rows = std::vector<std::vector<std::string> >;
+using Where = std::function<bool(const std::vector<int64_t> &)>;
+
+static void insert(SystemManager &manager, const std::string &table, const Plain &plain) {
+    for (size_t done = 0; done < plain.size(); done += INSERT_BATCH) {
+        std::ostringstream insert;
+        insert << "insert into " << table << " values ";
+        for (size_t r = done; r < std::min(plain.size(), done + INSERT_BATCH); r++) {
+            insert << (r > done ? ", (" : "(");
+            for (size_t c = 0; c < plain[r].size(); c++) {
+                insert << (c ? ", " : "") << plain[r][c];
+            }
+            insert << ")";
+        }
+        run(manager, insert.str() + ";");
+    }
+}
+
+// the rows of `resp` between its header and its timing line
+static Rows rowsOf(const std::string &resp) {
+    Rows rows;
+    std::istringstream lines(resp);
+    std::string line;
+    std::getline(lines, line);
+    while (std::getline(lines, line) && !line.starts_with("(")) {
+        std::istringstream fields(line);
+        rows.emplace_back();
+        for (std::string f; fields >> f;) {
+            rows.back().push_back(f);
+        }
+    }
+    return rows;
+}
+
+// fields `columns` of the rows of `plain` passing `where`
+static Rows project(const Plain &plain, const std::vector<int> &columns, const Where &where) {
+    Rows rows;
+    for (const auto &r: plain) {
+        if (!where(r)) {
+            continue;
+        }
+        rows.emplace_back();
+        for (int c: columns) {
+            rows.back().push_back(std::to_string(r[c]));
+        }
+    }
+    return rows;
+}
+
+// COUNT(*), SUM(sum), MIN(min), MAX(max) and AVG(sum) of `rows` as Aggregate::format prints them
+static std::vector<std::string> aggregates(const std::vector<const std::vector<int64_t> *> &rows, int sum, int min,
+                                           int max) {
+    if (rows.empty()) {
+        return {"0", "0", "NULL", "NULL", "NULL"};
+    }
+    int64_t total = 0, lo = INT64_MAX, hi = INT64_MIN;
+    for (const auto *r: rows) {
+        total += (*r)[sum];
+        lo = std::min(lo, (*r)[min]);
+        hi = std::max(hi, (*r)[max]);
+    }
+    std::ostringstream avg;
+    avg << static_cast<double>(total) / static_cast<double>(rows.size());
+    return {std::to_string(rows.size()), std::to_string(total), std::to_string(lo), std::to_string(hi), avg.str()};
+}
+
+static json check(SystemManager &manager, size_t rows, int &failures) {
+    // f (k, a, b, c, flag) with distinct values of a, so that every ORDER BY a has one answer.
+    // The keys of d are unique and miss some keys of f, e stays empty.
+    std::mt19937_64 rand(rows);
+    std::uniform_int_distribution<int64_t> key(-4, 4), small(-1000, 1000), bit(0, 1);
+    std::vector<int64_t> as(rows);
+    for (size_t i = 0; i < rows; i++) {
+        as[i] = static_cast<int64_t>(i * 7) - static_cast<int64_t>(rows) * 3;
+    }
+    std::ranges::shuffle(as, rand);
+    Plain f, d;
+    for (size_t i = 0; i < rows; i++) {
+        f.push_back({key(rand), as[i], small(rand), small(rand), bit(rand)});
+    }
+    for (int64_t k: {-4, -3, -1, 0, 2, 3}) {
+        d.push_back({k, small(rand)});
+    }
+    run(manager, "create table f (k int(8), a int(32), b int(16), c int(16), flag boolean);");
+    run(manager, "create table d (k int(8), v int(32));");
+    run(manager, "create table e (k int(8), v int(32));");
+    insert(manager, "f", f);
+    insert(manager, "d", d);
+
+    json results = json::array();
+    auto expect = [&](const std::string &query, Rows expected, bool ordered) {
+        std::string resp = manager.clientExecute(query);
+        Rows got = rowsOf(resp);
+        if (!ordered) {
+            std::ranges::sort(got);
+            std::ranges::sort(expected);
+        }
+        bool ok = !resp.starts_with("Failed") && got == expected;
+        json j;
+        j["query"] = query;
+        j["ok"] = ok;
+        if (!ok) {
+            j["expected_rows"] = expected.size();
+            j["response"] = resp.substr(0, 1024);
+            failures++;
+        }
+        std::cerr << j.dump() << std::endl;
+        results.push_back(j);
+    };
+    auto all = [](const std::vector<int64_t> &) { return true; };
+    // the second fields of the left and right records sharing their key, `where` filters the right ones
+    auto join = [](const Plain &left, const Plain &right, const Where &where) {
+        Rows joined;
+        for (const auto &l: left) {
+            for (const auto &r: right) {
+                if (l[0] == r[0] && where(r)) {
+                    joined.push_back({std::to_string(l[1]), std::to_string(r[1])});
+                }
+            }
+        }
+        return joined;
+    };
+
+    // constant WHERE
+    expect("select * from f where 1;", project(f, {0, 1, 2, 3, 4}, all), false);
+    expect("select * from f where 0;", {}, false);
+
+    // filters, compared field against field and constant, and joins, revealed through every compaction
+    for (std::string mode: {"exact", "padded", "off"}) {
+        run(manager, "set compaction " + mode + ";");
+        expect("select a, b from f where b <= 100 and k >= -2 or a = " + std::to_string(as[0]) + ";",
+               project(f, {1, 2}, [&](const auto &r) { return (r[2] <= 100 && r[0] >= -2) || r[1] == as[0]; }), false);
+        expect("select a, c, flag from f where b between -200 and 300 and not flag;",
+               project(f, {1, 3, 4}, [](const auto &r) { return r[2] >= -200 && r[2] <= 300 && !r[4]; }), false);
+        expect("select k, a from f where b < c;", project(f, {0, 1}, [](const auto &r) { return r[2] < r[3]; }),
+               false);
+        expect("select f.a, d.v from f join d on f.k = d.k;", join(f, d, all), false);
+        expect("select f.a, d.v from f join d on f.k = d.k where d.v > 0;",
+               join(f, d, [](const auto &r) { return r[1] > 0; }), false);
+        expect("select f.a, e.v from f join e on f.k = e.k;", {}, false);
+        expect("select e.v, d.v from e join d on e.k = d.k;", {}, false);
+    }
+    run(manager, "set compaction exact;");
+
+    // aggregates, with GROUP BY through the segmented scan
+    auto matching = [&](const Where &where) {
+        std::vector<const std::vector<int64_t> *> ret;
+        for (const auto &r: f) {
+            if (where(r)) {
+                ret.push_back(&r);
+            }
+        }
+        return ret;
+    };
+    expect("select count(*), sum(b), min(a), max(a), avg(b) from f where k = 1;",
+           {aggregates(matching([](const auto &r) { return r[0] == 1; }), 2, 1, 1)}, true);
+    expect("select count(*), sum(c), min(b), max(c), avg(c) from f where 0;", {aggregates({}, 3, 2, 3)}, true);
+    for (std::string where: {"", " where flag"}) {
+        Rows groups;
+        for (int64_t k = -4; k <= 4; k++) {
+            auto group = matching([&](const auto &r) { return r[0] == k && (where.empty() || r[4]); });
+            if (!group.empty()) {
+                groups.push_back({std::to_string(k)});
+                for (auto &v: aggregates(group, 2, 3, 1)) {
+                    groups.back().push_back(v);
+                }
+            }
+        }
+        expect("select k, count(*), sum(b), min(c), max(a), avg(b) from f" + where + " group by k;", groups, false);
+    }
+
+    // ORDER BY and top-k under every sorting setting
+    Plain sorted = f;
+    std::ranges::sort(sorted, [](const auto &x, const auto &y) { return x[1] < y[1]; });
+    Plain top(sorted.rbegin(), sorted.rbegin() + static_cast<int64_t>(std::min<size_t>(10, rows)));
+    Plain window;
+    for (const auto &r: sorted) {
+        if (r[2] > 0) {
+            window.push_back(r);
+        }
+    }
+    window.erase(window.begin(), window.begin() + std::min<size_t>(3, window.size()));
+    window.resize(std::min<size_t>(5, window.size()));
+    for (auto [network, mode]: std::vector<std::pair<std::string, std::string> >{
+             {"odd_even", "batched"}, {"bitonic", "batched"}, {"odd_even", "shuffle"}, {"odd_even", "key_only"}
+         }) {
+        run(manager, "set sort_network " + network + ";");
+        run(manager, "set sort_mode " + mode + ";");
+        expect("select * from f order by a;", project(sorted, {0, 1, 2, 3, 4}, all), true);
+        expect("select a, b from f order by a desc limit 10;", project(top, {1, 2}, all), true);
+        expect("select a from f where b > 0 order by a limit 5 offset 3;", project(window, {1}, all), true);
+    }
+    run(manager, "set sort_mode batched;");
+
+    for (const auto *table: {"f", "d", "e"}) {
+        run(manager, std::string("drop table ") + table + ";");
+    }
+    return results;
+}
+
+int main(int argc, char **argv) {
+    Comm::init(argc, argv);
+    bool checking = argc > 1 && std::string(argv[1]) == "check";
+    size_t checkRows = checking && argc > 2 ? std::stoull(argv[2]) : 300;
+    int maxLogRows = argc > 1 && !checking ? std::stoi(argv[1]) : 20;
+    int maxLogSortRows = argc > 2 && !checking ? std::stoi(argv[2]) : 16;
+
+    // a fresh data directory, so that the benchmark includes the cost of persistence
+    std::string dir = "benchmark_data/" + std::to_string(Comm::rank());
+    std::filesystem::remove_all(dir);
+    SystemManager &manager = SystemManager::getInstance();
+    manager.open(dir);
+
+    if (Comm::rank() != Comm::CLIENT_RANK) {
+        manager.serverExecute();
+        Comm::finalize();
+        return 0;
+    }
+
+    Dealer::startPool();
+    json results = json::array();
+    int failures = 0;
+    try {
+        if (checking) {
+            run(manager, "create database check;");
+            run(manager, "use check;");
+            results = check(manager, checkRows, failures);
+        } else {
+            run(manager, "create database bench;");
+            run(manager, "use bench;");
+            for (int logRows = MIN_LOG_ROWS; logRows <= maxLogRows; logRows += 2) {
+                for (int columns: COLUMNS) {
+                    for (int width: WIDTHS) {
+                        for (auto &r: benchmark(manager, logRows, columns, width, logRows <= maxLogSortRows)) {
+                            std::cerr << r.dump() << std::endl;
+                            results.push_back(r);
+                        }
+                    }
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        failures++;
+    }
+    std::cout << results.dump(2) << std::endl;
+
+    manager.shutdown();
+    Comm::finalize();
+    return checking && failures ? 1 : 0;
+}
@@ -12,13 +12,15 @@
 #include <mpc_package/api/IntSecret.h>
 #include <mpc_package/api/BitSecret.h>
 
+using FieldValue = std::variant<BitSecret, IntSecret<int8_t>, IntSecret<int16_t>, IntSecret<int32_t>, IntSecret<int64_t>>;
+
 class AbstractRecord {
 public:
-    std::vector<std::variant<BitSecret, IntSecret<int8_t>, IntSecret<int16_t>, IntSecret<int32_t>, IntSecret<int64_t>>> _fieldValues;
+    std::vector<FieldValue> _fieldValues;
 
     AbstractRecord() = default;
 
-    void addField(std::variant<BitSecret, IntSecret<int8_t>, IntSecret<int16_t>, IntSecret<int32_t>, IntSecret<int64_t>> secret, int type);
+    void addField(FieldValue secret, int type);
 
     void print(std::ostringstream& oss) const;
 
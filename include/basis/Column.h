@@ -0,0 +1,116 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "./AbstractRecord.h"
+
+// Read-only view over a bit-packed BOOLEAN column (64 shares per word).
+class BitView {
+private:
+    const uint64_t *_words{};
+    size_t _size{};
+
+public:
+    BitView() = default;
+
+    BitView(const uint64_t *words, size_t size);
+
+    [[nodiscard]] bool operator[](size_t i) const;
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] const uint64_t *words() const;
+};
+
+// Contiguous share buffer of a single table field.
+// Integer shares are stored as consecutive T values, BOOLEAN shares are packed as bits.
+// The buffer lives in memory, or in a file mapped by open() that holds exactly this layout.
+class Column {
+private:
+    int _type{};
+    size_t _size{};
+    std::vector<uint8_t> _data;
+    // file backed buffer, the file may be longer than the shares it holds
+    int _fd = -1;
+    uint8_t *_map{};
+    size_t _capacity{};
+
+public:
+    Column() = default;
+
+    explicit Column(int type);
+
+    // adopt `size` shares already laid out in `data`
+    Column(int type, size_t size, std::vector<uint8_t> data);
+
+    Column(const Column &) = delete;
+
+    Column &operator=(const Column &) = delete;
+
+    Column(Column &&other) noexcept;
+
+    Column &operator=(Column &&other) noexcept;
+
+    ~Column();
+
+    // map the first `size` shares stored in `path`, creating the file if needed.
+    // Later appends grow the file.
+    bool open(const std::string &path, size_t size);
+
+    // write mapped shares back to the file
+    void flush() const;
+
+    [[nodiscard]] int type() const;
+
+    [[nodiscard]] size_t size() const;
+
+    // bytes occupied by `n` shares of this column
+    [[nodiscard]] size_t bytes(size_t n) const;
+
+    void reserve(size_t n);
+
+    void append(int64_t share);
+
+    void append(const FieldValue &secret);
+
+    // append every share of `other`, which has the same type
+    void append(const Column &other);
+
+    // keep the first `n` shares
+    void truncate(size_t n);
+
+    // whether plain value `v` is representable in a field of `type`
+    static bool fits(int64_t v, int type);
+
+    // raw share of row `i`, sign extended
+    [[nodiscard]] int64_t get(size_t i) const;
+
+    [[nodiscard]] FieldValue secret(size_t i) const;
+
+    template<typename T>
+    [[nodiscard]] std::span<const T> view() const {
+        return {reinterpret_cast<const T *>(data()), _size};
+    }
+
+    [[nodiscard]] BitView bits() const;
+
+    [[nodiscard]] const uint8_t *data() const;
+
+    // [rows][column 0]...[column n] for columns holding the same number of rows
+    static std::vector<uint8_t> pack(const std::vector<const Column *> &columns);
+
+    static std::vector<Column> unpack(const std::vector<uint8_t> &buffer, const std::vector<int> &types);
+
+private:
+    [[nodiscard]] uint8_t *mutableData();
+
+    // hold `n` bytes of shares, bytes past the current shares are zero
+    void resize(size_t n);
+};
+
+
+#endif //COLUMN_H
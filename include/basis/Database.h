@@ -12,9 +12,11 @@ class Database {
 private:
     std::string _databaseName;
     std::map<std::string, Table> _tables;
+    // share files of the tables, empty when they only live in memory
+    std::string _dir;
 
 public:
-    explicit Database(std::string databaseName);
+    explicit Database(std::string databaseName, std::string dir = "");
 
     Database();
 
@@ -22,8 +24,15 @@ public:
 
     bool createTable(const std::string& tableName, std::vector<std::string> fieldNames, std::vector<int> fieldTypes, std::string &msg);
 
+    // restore a table of which `size` records are stored on disk
+    bool openTable(const std::string& tableName, std::vector<std::string> fieldNames, std::vector<int> fieldTypes, size_t size);
+
     bool dropTable(const std::string& tableName, std::string &msg);
 
+    [[nodiscard]] const std::map<std::string, Table>& tables() const;
+
+    [[nodiscard]] const std::string& dir() const;
+
     Table* getTable(const std::string& tableName);
 };
 
@@ -0,0 +1,30 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+#include <memory>
+#include <string>
+#include <vector>
+
+// Field names and types of a table or an intermediate result.
+// Every record of a result points to the same immutable schema, operators that add or drop a field
+// build the changed schema once and hand it to all records.
+class Schema {
+public:
+    std::vector<std::string> _fieldNames;
+    std::vector<int> _types;
+
+    Schema() = default;
+
+    Schema(std::vector<std::string> fieldNames, std::vector<int> types);
+
+    // index of `fieldName`, or -1
+    [[nodiscard]] int getIdx(const std::string &fieldName) const;
+
+    // a copy with field `fieldName` of `type` placed before field `idx`
+    [[nodiscard]] std::shared_ptr<const Schema> insert(int idx, const std::string &fieldName, int type) const;
+
+    // a copy without field `idx`
+    [[nodiscard]] std::shared_ptr<const Schema> erase(int idx) const;
+};
+
+
+#endif //SCHEMA_H
@@ -6,28 +6,61 @@
 #define SMPC_DATABASE_TABLE_H
 #include <vector>
 
+#include "./Column.h"
+#include "./Schema.h"
 #include "./TableRecord.h"
 #include "./TempRecord.h"
 
 class Table {
 private:
     std::string _tableName;
-    std::vector<std::string> _fieldNames;
-    std::vector<int> _fieldTypes;
-    std::vector<TableRecord> _records;
+    // shared with the records selected from this table
+    std::shared_ptr<const Schema> _schema = std::make_shared<const Schema>();
+    // one share buffer per field
+    std::vector<Column> _columns;
+    size_t _size{};
 
 public:
     Table() = default;
 
     explicit Table(std::string tableName, std::vector<std::string> fieldNames, std::vector<int> fieldTypes);
 
+    // keep the shares in `dir`, one file per field, of which the first `size` records are already stored
+    bool open(const std::string &dir, size_t size);
+
+    void flush() const;
+
+    [[nodiscard]] const std::string &name() const;
+
     bool insert(const TableRecord& r);
 
+    // append a batch of share columns, one per field
+    bool insert(const std::vector<Column> &batch);
+
+    // drop every record after the first `n`
+    void truncate(size_t n);
+
     [[nodiscard]] std::vector<TempRecord> selectAll() const;
 
+    // records holding only the fields `fields`, in that order
+    [[nodiscard]] std::vector<TempRecord> select(const std::vector<int> &fields) const;
+
     const std::vector<std::string>& fieldNames() const;
 
-    const std::vector<int>& fieldTypes();
+    const std::vector<int>& fieldTypes() const;
+
+    [[nodiscard]] const std::shared_ptr<const Schema> &schema() const;
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] const Column &column(int idx) const;
+
+    template<typename T>
+    [[nodiscard]] std::span<const T> columnView(int idx) const {
+        return _columns[idx].view<T>();
+    }
+
+    [[nodiscard]] BitView bitColumnView(int idx) const;
 
     void muxSwap(int i, int j, BitSecret c);
 };
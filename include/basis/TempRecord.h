@@ -5,21 +5,30 @@
 #ifndef TEMPRECORD_H
 #define TEMPRECORD_H
 #include "./AbstractRecord.h"
+#include "./Schema.h"
 
 class TempRecord : public AbstractRecord {
 public:
-    std::vector<std::string> _fieldNames;
-    std::vector<int32_t> _types;
+    // shared with the other records of the same result, replaced rather than modified
+    std::shared_ptr<const Schema> _schema;
     BitSecret _valid = BitSecret(Comm::rank());
     bool _padding{};
 
     [[nodiscard]] int getType(int valueIdx) const override;
 
+    // append an unnamed field to a schema of this record only, records sharing a schema should get a new one
+    // from Schema::insert instead
     void addType(int type) override;
 
     [[nodiscard]] int getIdx(const std::string &fieldName) const override;
 
     [[nodiscard]] BitSecret compareField(const TempRecord &other, const std::string &fieldName) const;
+
+    // raw share of field `idx`, sign extended
+    [[nodiscard]] uint64_t share(int idx) const;
+
+    // replace field `idx` with a secret of the same type holding `share`
+    void setShare(int idx, uint64_t share);
 };
 
 
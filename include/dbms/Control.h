@@ -0,0 +1,49 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+#include <cstdint>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+// Binary control protocol from the client to the computing parties.
+// A command travels as [seq u64][type u8][payload as MessagePack] on CONTROL_TAG, and the servers start
+// commands in sequence order. Each server acknowledges a command on ACK_TAG once it finishes, which is out of
+// order for queries running concurrently, but the client keeps sending and only waits when too many commands
+// are in flight or it calls sync(). Client threads may send at once.
+class Control {
+public:
+    static constexpr int CONTROL_TAG = 66;
+    static constexpr int ACK_TAG = 67;
+    static constexpr uint64_t MAX_IN_FLIGHT = 256;
+
+    struct Command {
+        uint64_t seq;
+        int type;
+        nlohmann::json payload;
+    };
+
+private:
+    static std::mutex _mutex;
+    static uint64_t _sent;
+    // acknowledgements received from each computing party
+    static uint64_t _acked[2];
+
+public:
+    // client: send a command to both computing parties, returns its sequence number
+    static uint64_t send(int type, const nlohmann::json &payload);
+
+    // client: wait until both computing parties finished every command sent
+    static void sync();
+
+    // server: the next command of the client
+    static Command recv();
+
+    // server: report command `seq` as finished
+    static void ack(uint64_t seq);
+
+private:
+    // take the acknowledgements that arrived, blocking until at most `inFlight` commands are left
+    static void drain(uint64_t inFlight);
+};
+
+
+#endif //CONTROL_H
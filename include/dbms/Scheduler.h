@@ -0,0 +1,80 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./SystemManager.h"
+
+// Runs the commands of the front end sessions on the query slots of the client rank.
+// A shared command (see SystemManager::shared) runs next to other shared commands, at most `limit` at a time,
+// each on the thread of its own slot and thus on its own channels. Any other command changes state the others
+// read, so it waits until the running ones finish and then runs alone; shared commands arriving meanwhile wait
+// behind it. Sessions take turns round robin, and a session never has two commands running, so its commands
+// keep their order.
+class Scheduler {
+public:
+    static constexpr int DEFAULT_LIMIT = 4;
+
+    using Respond = std::function<void(std::string)>;
+
+private:
+    struct Pending {
+        // shared with the front end, which may close the connection meanwhile
+        std::shared_ptr<Session> session;
+        std::string command;
+        Respond respond;
+    };
+
+    struct Running {
+        uint64_t id{};
+        Pending pending;
+        bool active{};
+    };
+
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    // commands waiting per session
+    std::map<uint64_t, std::deque<Pending> > _queues;
+    // sessions with a running command
+    std::set<uint64_t> _busy;
+    // session that started a command last, the next turn goes to the one after it
+    uint64_t _turn{};
+    bool _exclusive{};
+    // the command each slot runs
+    std::vector<Running> _slots;
+    std::vector<std::thread> _threads;
+    bool _stop{};
+
+public:
+    explicit Scheduler(int limit = DEFAULT_LIMIT);
+
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    // queue `command` of `id` and call `respond` with its response once it ran
+    void submit(uint64_t id, const std::shared_ptr<Session> &session, std::string command, Respond respond);
+
+private:
+    // start what may run now, under _mutex
+    void dispatch();
+
+    // hand the next command of session `id` to `slot`, under _mutex
+    void start(uint64_t id, int slot);
+
+    void loop(int slot);
+};
+
+
+#endif //SCHEDULER_H
@@ -8,12 +8,24 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <thread>
 #include "../basis/Database.h"
 #include <nlohmann/json.hpp>
 #include <sql/SQLStatement.h>
 
 using json = nlohmann::json;
 
+// state of one front end connection, swapped in while it runs a command
+struct Session {
+    std::string database;
+    std::map<std::string, std::string> settings = {
+        {"sort_mode", "batched"},
+        {"sort_network", "odd_even"},
+        {"compaction", "exact"},
+        {"workers", "auto"}
+    };
+};
+
 class SystemManager {
 public:
     enum CommandType {
@@ -25,14 +37,27 @@ public:
         DROP_TABLE,
         INSERT,
         SELECT,
+        LOAD,
+        PREPROCESS,
+        STATS,
         UNKNOWN
     };
 
     std::map<std::string, Database> _databases;
-    Database *_currentDatabase = nullptr;
+    // per thread, as every query slot runs a command of its own session
+    static thread_local Database *_currentDatabase;
+
+    // catalog of this rank and, on computing parties, the share files of every table
+    std::string _dataDir;
+
+    // session settings changed by `set <name> <value>`, per thread like _currentDatabase
+    static thread_local std::map<std::string, std::string> _settings;
 
-    // temp
-    int done{};
+    // database the computing parties currently use
+    std::string _serversDatabase;
+
+    // query slots of the client's scheduler, PREPROCESS stocks the channels of each
+    int _querySlots = 1;
 
 private:
     // private constructor
@@ -46,28 +71,64 @@ public:
 
     static SystemManager &getInstance();
 
+    // restore the databases stored in `dataDir`
+    void open(const std::string &dataDir);
+
+    // flush the share files of every table, then write the catalog
+    void save() const;
+
+    // write the catalog with the row count of every table, without flushing any share file
+    void saveCatalog() const;
+
     bool createDatabase(const std::string &dbName, std::string &msg);
 
     bool dropDatabase(const std::string &dbName, std::string &msg);
 
     bool useDatabase(const std::string &dbName, std::string &msg);
 
-    static void log(const std::string &msg, bool success);
+    // run `command` and return the response for the user
+    std::string clientExecute(const std::string &command);
 
-    void clientExecute(const std::string &command);
+    // run `command` with the database and settings of `session`
+    std::string clientExecute(const std::string &command, Session &session);
 
-    static void notifyServersSync(json &j);
+    // Whether `command` may run next to other commands: a SELECT whose protocols all run on the channels of
+    // its slot. The sequential sort goes through mpc_package, which has no slots.
+    static bool shared(const std::string &command, const Session &session);
 
-    void serverExecute();
+    // channel traffic and operator costs of every rank, indexed by rank
+    json collectStats();
 
-    static CommandType getCommandType(const std::string &prefix);
+    // tell the servers to leave serverExecute()
+    void shutdown();
 
-    static std::string getCommandPrefix(CommandType type);
+    // pipeline command `type` to both computing parties without waiting for it, returns its sequence number
+    static uint64_t notifyServers(CommandType type, const json &j);
+
+    // send command `type` and wait until the computing parties finished it and every earlier command
+    static void notifyServersSync(CommandType type, const json &j);
+
+    void serverExecute();
 
 private:
     bool clientCreateDeleteDb(std::istringstream &iss, std::ostringstream &resp, std::string &word, bool create);
 
     void clientUseDb(std::istringstream &iss, std::ostringstream &resp);
+
+    void clientSet(std::istringstream &iss, std::ostringstream &resp);
+
+    // `preprocess <n> [width]`: stock the servers with randomness for n comparisons and n muxes of width-bit values
+    void clientPreprocess(std::istringstream &iss, std::ostringstream &resp);
+
+    static void serverPreprocess(json &j);
+
+    // run a SELECT on the thread of the slot the client gave it, then acknowledge it
+    void serverQuery(std::vector<std::thread> &slots, uint64_t seq, json j);
+
+    void clientStats(std::ostringstream &resp);
+
+    // run the query after `explain analyze` and report the cost of each operator instead of its result
+    void clientExplainAnalyze(const std::string &query, std::ostringstream &resp);
 };
 
 #endif //SMPC_DATABASE_DBMS_H
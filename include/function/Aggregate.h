@@ -0,0 +1,50 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+#include <sstream>
+#include <nlohmann/json.hpp>
+#include <sql/SQLStatement.h>
+
+#include "basis/Table.h"
+#include "basis/TempRecord.h"
+#include "secret/Channel.h"
+
+// Oblivious COUNT, SUM, MIN, MAX and AVG over the records that pass the WHERE clause.
+// COUNT and SUM add shares locally once the match bits are arithmetic, MIN and MAX run a tournament of
+// batched comparisons in log2(n) rounds. Only the final scalars are revealed: AVG opens its sum and count,
+// MIN and MAX also open whether any record matched.
+// With GROUP BY the records are sorted by the grouping fields and a segmented scan of log2(n) levels
+// carries every aggregate along its group. The grouping fields are selected as `key` aggregates.
+class Aggregate {
+public:
+    // whether the select list holds an aggregate
+    static bool contains(const std::vector<hsql::Expr *> *selectList);
+
+    // client: encode the aggregates of `selectList` and their column headers.
+    // Only the fields in `groupFields` may be selected as they are.
+    static bool encode(std::ostringstream &resp, const std::vector<hsql::Expr *> *selectList, const Table *table,
+                       const std::vector<std::string> &groupFields, nlohmann::json &out,
+                       std::vector<std::string> &labels);
+
+    // types of the columns the servers reveal for `aggregates`
+    static std::vector<int> types(const nlohmann::json &aggregates);
+
+    // server: the aggregates over the records of `table` whose bit is set in packed `matches`,
+    // or over every record when it is empty. Each column holds one share and they are laid out as types().
+    static std::vector<Column> evaluate(const nlohmann::json &aggregates, const Table *table,
+                                        const std::vector<uint64_t> &matches, const Channel &ch);
+
+    // server: sort `records` by `groupFields` and compute the aggregates of every group.
+    // Each column holds one share per record laid out as types(), followed by the packed bits marking
+    // the last record of each group that has a record passing WHERE. The other records hold zeros in every column.
+    // Group sizes stay secret as long as the records are compacted before they are revealed.
+    static std::vector<Column> evaluateGroups(const nlohmann::json &aggregates,
+                                              const std::vector<std::string> &groupFields,
+                                              std::vector<TempRecord> &records, int workers, const Channel &ch);
+
+    // client: the result of each aggregate in `row` of the revealed columns, NULL over no records
+    static std::vector<std::string> format(const nlohmann::json &aggregates,
+                                           const std::vector<std::vector<int64_t> > &values, size_t row = 0);
+};
+
+
+#endif //AGGREGATE_H
@@ -0,0 +1,24 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+#include <cstdint>
+#include <vector>
+
+#include "basis/Column.h"
+#include "secret/Channel.h"
+
+// Oblivious compaction of a result before it is revealed, so the client receives about as many rows as pass
+// the query instead of every row of the table.
+// A prefix sum over the arithmetic valid bits, local to each party, gives every valid row its rank and every
+// other row a place after them. The rows are shuffled with Batch::shuffle along with their places, which then
+// form a uniformly random permutation and are revealed, and the rows move in the clear. Valid rows keep their
+// order. The servers learn how many rows are valid, or only its next power of two when padding.
+class Compact {
+public:
+    // server: the rows of `columns`, whose last column holds the valid bits, with the valid ones in front.
+    // They are cut to the valid count or, when `padded`, its next power of two, and to `limit` unless negative.
+    static std::vector<Column> evaluate(const std::vector<const Column *> &columns, bool padded, int64_t limit,
+                                        const Channel &ch);
+};
+
+
+#endif //COMPACT_H
@@ -0,0 +1,24 @@
+#ifndef FILTER_H
+#define FILTER_H
+#include <sstream>
+#include <nlohmann/json.hpp>
+#include <sql/SQLStatement.h>
+
+#include "basis/Table.h"
+#include "secret/Channel.h"
+
+// Oblivious WHERE. Every predicate runs as one batched secure operation over whole columns,
+// so the servers learn the shared match bit of each record and never which records match.
+// Comparisons with a constant or between fields of the same width, =, !=, <, <=, >, >=, BETWEEN,
+// AND, OR, NOT and BOOLEAN fields are supported.
+class Filter {
+public:
+    // client: check `where` against the fields of `table` and encode it for the servers
+    static bool encode(std::ostringstream &resp, const hsql::Expr *where, const Table *table, nlohmann::json &out);
+
+    // server: packed [where] of every record of `table`
+    static std::vector<uint64_t> evaluate(const nlohmann::json &where, const Table *table, const Channel &ch);
+};
+
+
+#endif //FILTER_H
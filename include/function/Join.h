@@ -0,0 +1,35 @@
+#ifndef JOIN_H
+#define JOIN_H
+#include <sstream>
+#include <nlohmann/json.hpp>
+#include <sql/SQLStatement.h>
+
+#include "basis/Database.h"
+#include "basis/Table.h"
+#include "secret/Channel.h"
+
+// Oblivious sort-merge inner equi-join `left JOIN right ON left.a = right.b`, where the keys of the right table
+// are unique, as in a fact table joined with a dimension table. Uniqueness cannot be checked on shares: a left
+// record whose key several right records share is joined with one of them.
+// Both tables are concatenated with a source tag and sorted by (key, tag) with the batched sorting network, so
+// every right record lands before the left records sharing its key. A scan of log2(n + m) levels of batched
+// muxes then carries each right record down to those left records, and one batched equality test per record
+// marks the matches. The cost is O((n + m) log²(n + m)) instead of the O(n·m) of a nested loop.
+// The WHERE clause may filter the fields of one table.
+class Join {
+public:
+    // client: check the join of `selectStmt` within `database` and encode it for the servers,
+    // along with the header and type of every output column
+    static bool encode(std::ostringstream &resp, const hsql::SelectStatement *selectStmt, Database *database,
+                       nlohmann::json &out, std::vector<std::string> &labels, std::vector<int> &types);
+
+    // server: one share per concatenated record of every output column, followed by the packed bits marking the
+    // left records that found their right record. Records failing WHERE have their bit cleared in packed
+    // `leftMatches` or `rightMatches`, which are empty when every record passes.
+    static std::vector<Column> evaluate(const nlohmann::json &join, const Table *left, const Table *right,
+                                        const std::vector<uint64_t> &leftMatches,
+                                        const std::vector<uint64_t> &rightMatches, int workers, const Channel &ch);
+};
+
+
+#endif //JOIN_H
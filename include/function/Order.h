@@ -5,6 +5,8 @@
 #ifndef ORDER_H
 #define ORDER_H
 #include "basis/TempRecord.h"
+#include "function/SortingNetwork.h"
+#include "secret/Channel.h"
 
 class Order {
 public:
@@ -17,6 +19,55 @@ public:
     static void bitonicSort(std::vector<TempRecord> &records,
                             const std::vector<std::string> &fieldNames,
                             const std::vector<BitSecret> &ascendingOrders);
+
+    // Packed swap bits of the comparators (r0, r1) in `pairs`, computed with batched comparisons
+    static std::vector<uint64_t> requiresSwapBatched(const std::vector<TempRecord> &records,
+                                                     const std::vector<std::pair<size_t, size_t> > &pairs,
+                                                     const std::vector<std::string> &orderFields,
+                                                     const std::vector<bool> &ascendingOrders,
+                                                     const Channel &ch);
+
+    static void muxSwapBatched(std::vector<TempRecord> &records,
+                               const std::vector<std::pair<size_t, size_t> > &pairs,
+                               const std::vector<uint64_t> &swaps,
+                               const Channel &ch);
+
+    // Sort along the schedule of `network`, where all comparators of a stage share one compare and one mux call,
+    // so the rounds grow with the number of stages instead of the number of comparators.
+    // The comparators of a stage are split across `workers` threads.
+    static void sortBatched(std::vector<TempRecord> &records,
+                            const std::vector<std::string> &fieldNames,
+                            const std::vector<bool> &ascendingOrders,
+                            int workers = 1,
+                            SortingNetwork::Kind network = SortingNetwork::ODD_EVEN_MERGE);
+
+    // Shuffle the records with Batch::shuffle, then quicksort them: each round compares every record with the
+    // pivot of its part in one batched call and reveals the results, so the records move in the clear.
+    // The original position breaks ties, which keeps the keys distinct and the order stable; on distinct keys in
+    // random order the revealed results tell nothing but n. O(n log n) comparisons and no mux in O(log n) rounds.
+    static void shuffleSort(std::vector<TempRecord> &records,
+                            const std::vector<std::string> &fieldNames,
+                            const std::vector<bool> &ascendingOrders,
+                            int workers = 1);
+
+    // Sort (ordering fields, original position) pairs with sortBatched and move the whole records once:
+    // the records are shuffled first, so the sorted positions within the shuffled records are uniformly random
+    // and can be revealed. The payload costs one shuffle, O(n) instead of a mux at each of the O(n log² n)
+    // comparators, which pays off for wide records sorted on narrow keys.
+    static void keySort(std::vector<TempRecord> &records,
+                        const std::vector<std::string> &fieldNames,
+                        const std::vector<bool> &ascendingOrders,
+                        int workers = 1);
+
+    // Keep the first `k` records in order, those whose valid bit is unset ranking last.
+    // Blocks of k records are sorted and then merged pairwise, each merge keeping only the first k of both,
+    // so the network has O(n log² k) comparators instead of O(n log² n).
+    // When k rounded up to a power of two covers every record, they are all sorted along `network`.
+    static void topK(std::vector<TempRecord> &records,
+                     const std::vector<std::string> &fieldNames,
+                     const std::vector<bool> &ascendingOrders,
+                     size_t k, int workers = 1,
+                     SortingNetwork::Kind network = SortingNetwork::ODD_EVEN_MERGE);
 };
 
 
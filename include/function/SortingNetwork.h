@@ -0,0 +1,48 @@
+#ifndef SORTINGNETWORK_H
+#define SORTINGNETWORK_H
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Comparator schedules of Batcher's networks for any number of positions.
+// Every comparator moves the smaller record to its first position, so a network on 2^k positions cut down to the
+// comparators among the first n still sorts n positions: the cut positions would hold records larger than any
+// other, which no comparator moves. No padding records are needed and no comparator is spent on them.
+// A stage expands to its comparators on demand, as the whole schedule grows with n log² n.
+class SortingNetwork {
+public:
+    enum Kind {
+        // bitonic sort with every merge starting by comparing its halves in reverse
+        BITONIC,
+        // odd-even merge sort, about a third fewer comparators in as many stages
+        ODD_EVEN_MERGE
+    };
+
+private:
+    size_t _n;
+    Kind _kind;
+    // (block, distance) of the stages that keep a comparator
+    std::vector<std::pair<size_t, size_t> > _stages;
+
+public:
+    SortingNetwork(size_t n, Kind kind);
+
+    // the network on `n` positions, built once per (n, kind)
+    static std::shared_ptr<const SortingNetwork> of(size_t n, Kind kind);
+
+    // kind named `name` by the sort_network setting
+    static Kind parse(const std::string &name);
+
+    [[nodiscard]] size_t stages() const;
+
+    // the comparators of stage `s`, which touch disjoint positions
+    void stage(size_t s, std::vector<std::pair<size_t, size_t> > &comparators) const;
+
+private:
+    void expand(size_t block, size_t distance, std::vector<std::pair<size_t, size_t> > &comparators) const;
+};
+
+
+#endif //SORTINGNETWORK_H
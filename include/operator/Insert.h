@@ -8,12 +8,24 @@
 #include <nlohmann/json.hpp>
 #include <sql/SQLStatement.h>
 
+class Table;
 
 class Insert {
 public:
     static bool clientInsert(std::ostringstream &resp, const hsql::SQLStatement *stmt);
 
+    // `insert into t [(...)] values (...), (...), ...` which the SQL parser rejects
+    static bool clientInsertRows(std::ostringstream &resp, const std::string &command);
+
     static void serverInsert(nlohmann::basic_json<> j);
+
+    // an integer, `true` or `false`
+    static bool parseLiteral(std::string token, int64_t &v);
+
+private:
+    // share rows[row][column] of the inserted columns `cols` to the servers in one batch
+    static bool insertRows(std::ostringstream &resp, Table *table, const std::string &tableName,
+                           const std::vector<std::string> &cols, const std::vector<std::vector<int64_t> > &rows);
 };
 
 
@@ -0,0 +1,24 @@
+#ifndef LOAD_H
+#define LOAD_H
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+
+// `load data infile '<path>' into table <name> [format csv|binary] [ignore <n> lines]`
+// The client reads its local file in chunks of CHUNK_ROWS records and streams the shares of
+// every chunk to the servers, so memory stays bounded by one chunk on every rank.
+// CSV holds one record per line with every field in table order.
+// Binary holds packed little endian records, each field is width / 8 bytes and a BOOLEAN is one byte.
+// A load either appends every record of the file or none of them.
+class Load {
+public:
+    static constexpr size_t CHUNK_ROWS = 1 << 16;
+
+    static bool clientLoad(std::ostringstream &resp, std::istringstream &iss);
+
+    static void serverLoad(nlohmann::basic_json<> j);
+};
+
+
+
+#endif //LOAD_H
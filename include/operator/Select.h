@@ -14,6 +14,11 @@ public:
     static bool clientSelect(std::ostringstream &resp, const hsql::SQLStatement *stmt);
 
     static void serverSelect(json j);
+
+private:
+    static bool clientJoin(std::ostringstream &resp, const hsql::SelectStatement *selectStmt);
+
+    static void serverJoin(const json &j);
 };
 
 
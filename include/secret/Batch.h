@@ -0,0 +1,83 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <cstdint>
+#include <vector>
+
+#include "./Channel.h"
+
+// Vectorized secure operations on raw shares of the two computing parties.
+// Every call costs a fixed number of rounds no matter how many elements it processes.
+// Integers are additive shares mod 2^64 whose low `width` bits hold the value,
+// bits are XOR shares packed 64 per word.
+class Batch {
+public:
+    // words holding `n` packed bits
+    static size_t words(size_t n);
+
+    static bool bit(const std::vector<uint64_t> &bits, size_t i);
+
+    static void setBit(std::vector<uint64_t> &bits, size_t i, bool v);
+
+    // the first `n` packed bits moved `d` rows down, the first `d` rows hold 0
+    static std::vector<uint64_t> shift(const std::vector<uint64_t> &bits, size_t n, size_t d);
+
+    // [!x], flipping the share of party 0 only
+    static std::vector<uint64_t> not_(std::vector<uint64_t> x);
+
+    // [x & y], one round
+    static std::vector<uint64_t> and_(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                      const Channel &ch);
+
+    // [x * y], one round
+    static std::vector<uint64_t> mul(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                     const Channel &ch);
+
+    // additive shares of the first `n` packed bits, one round
+    static std::vector<uint64_t> toArith(const std::vector<uint64_t> &bits, size_t n, const Channel &ch);
+
+    // [cond ? x : y] for additive x and y and packed cond
+    static std::vector<uint64_t> mux(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                     const std::vector<uint64_t> &cond, const Channel &ch);
+
+    // packed most significant bits of `width`-bit values, log2(width) + 1 rounds
+    static std::vector<uint64_t> msb(const std::vector<uint64_t> &x, int width, const Channel &ch);
+
+    // packed [x < y] of signed `width`-bit values
+    static std::vector<uint64_t> lessThan(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y, int width,
+                                          const Channel &ch);
+
+    // AND words consumed by lessThan() on `n` values
+    static size_t lessThanWords(int width, size_t n);
+
+    // packed [x < y] in words [0, w) and [x == y] in words [w, 2w), w = words(n), of signed `width`-bit values.
+    // Both come from one msb() pass, with the rounds of lessThan()
+    static std::vector<uint64_t> compare(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y, int width,
+                                         const Channel &ch);
+
+    // AND words consumed by compare() on `n` values
+    static size_t compareWords(int width, size_t n);
+
+    // packed [x == y] of `width`-bit values, log2(width) rounds
+    static std::vector<uint64_t> equal(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y, int width,
+                                       const Channel &ch);
+
+    // 64-bit shares of signed `width`-bit values, so that sums of them no longer wrap at 2^width.
+    // log2(width) + 2 rounds
+    static std::vector<uint64_t> extend(const std::vector<uint64_t> &x, int width, const Channel &ch);
+
+    // [x | y]
+    static std::vector<uint64_t> or_(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                     const Channel &ch);
+
+    // Reorder the rows of `rows`, each `width` words of which the first `ints` are additive shares and the others
+    // XOR shares, by a random permutation neither party knows. Each party permutes once with a permutation
+    // of the dealer while the other masks its shares, so both end up with fresh shares. Two rounds.
+    static void shuffle(std::vector<uint64_t> &rows, size_t width, size_t ints, const Channel &ch);
+
+private:
+    // AND words consumed by msb() on `n` values
+    static size_t msbWords(int width, size_t n);
+};
+
+
+#endif //BATCH_H
@@ -0,0 +1,94 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Tagged point-to-point link used by the batched protocols.
+// Messages of different tags never interleave, tags below DEALER_TAG are left to mpc_package.
+// DEALER_TAG + 2 and + 3 carry the control protocol (Control).
+// Channels may be used from several threads at once, one thread per tag.
+// Concurrent queries run in slots: a thread bound to slot s shifts the query tags (DEALER_TAG, DEFAULT_TAG
+// and WORKER_TAG + i) of the channels it constructs by s * SLOT_TAGS, so queries never read each other's messages.
+class Channel {
+public:
+    // traffic of this rank on every channel since it started
+    struct Traffic {
+        uint64_t bytes;
+        uint64_t messages;
+        // receives this rank had to wait for
+        uint64_t rounds;
+    };
+
+    static constexpr int DEALER_TAG = 64;
+    static constexpr int DEFAULT_TAG = 65;
+    // worker `i` of a WorkerPool talks on WORKER_TAG + i
+    static constexpr int WORKER_TAG = 128;
+    static constexpr int SLOT_TAGS = 256;
+    static constexpr int MAX_SLOTS = 16;
+
+private:
+    int _tag;
+    // query slot of this thread
+    static thread_local int _slot;
+
+public:
+    explicit Channel(int tag = DEFAULT_TAG);
+
+    // the channel on `tag` as it is, whatever slot this thread is bound to
+    static Channel exact(int tag);
+
+    [[nodiscard]] int tag() const;
+
+    // channels constructed on this thread from now on belong to query slot `slot`
+    static void bind(int slot);
+
+    [[nodiscard]] static int slot();
+
+    // the other computing party
+    static int peer();
+
+    static Traffic traffic();
+
+    // traffic of this rank on the query channels of slot `slot`, which no other query uses while it runs
+    static Traffic traffic(int slot);
+
+    template<typename T>
+    void send(const std::vector<T> &v, int receiverRank) const {
+        sendBytes(v.data(), v.size() * sizeof(T), receiverRank);
+    }
+
+    template<typename T>
+    std::vector<T> recv(int senderRank) const {
+        std::vector<T> v;
+        recvBytes(senderRank, [&v](size_t bytes) {
+            v.resize(bytes / sizeof(T));
+            return static_cast<void *>(v.data());
+        });
+        return v;
+    }
+
+    // whether a message from `senderRank` is waiting to be received
+    [[nodiscard]] bool pending(int senderRank) const;
+
+    // send `v` to the other computing party and receive its vector within the same round
+    template<typename T>
+    std::vector<T> exchange(const std::vector<T> &v) const {
+        std::vector<T> ret;
+        exchangeBytes(v.data(), v.size() * sizeof(T), [&ret](size_t bytes) {
+            ret.resize(bytes / sizeof(T));
+            return static_cast<void *>(ret.data());
+        });
+        return ret;
+    }
+
+private:
+    void sendBytes(const void *data, size_t bytes, int receiverRank) const;
+
+    void recvBytes(int senderRank, const std::function<void *(size_t)> &allocate) const;
+
+    void exchangeBytes(const void *data, size_t bytes, const std::function<void *(size_t)> &allocate) const;
+};
+
+
+#endif //CHANNEL_H
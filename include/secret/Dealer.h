@@ -0,0 +1,72 @@
+#ifndef DEALER_H
+#define DEALER_H
+#include <cstdint>
+#include <vector>
+
+#include "./Channel.h"
+
+// Correlated randomness for the batched protocols.
+// The client rank deals it on request of computing party 0; both computing parties keep what was dealt
+// in a stock per channel and consume it in the same order, so their stocks never diverge.
+// The client generates randomness ahead of requests in a background pool, and the servers can fill
+// their stocks before a query with `preprocess`, which leaves the online phase with no dealing at all.
+// Triples are word packed (AND) or mod 2^64 (MUL), so one stock serves every field width.
+class Dealer {
+public:
+    enum Kind : uint64_t {
+        END,
+        // XOR shared words a, b, c with c = a & b
+        AND_TRIPLES,
+        // additive shares a, b, c mod 2^64 with c = a * b
+        MUL_TRIPLES,
+        // a random bit word shared by XOR and each of its 64 bits shared additively
+        RANDOM_BITS,
+        // the masks of a shuffle (see Pass), dealt for one shuffle at a time and never stocked
+        SHUFFLE
+    };
+
+    // One pass of a shuffle of n rows, in which the permuting party learns `perm` and `delta` and the other
+    // party the masks `a` and `c`. Row i of delta is row perm[i] of a minus row i of c, or XOR for the words
+    // shared by XOR.
+    struct Pass {
+        std::vector<uint64_t> perm, delta, a, c;
+    };
+
+    // a request never fetches less than this many units, so short operators share one round trip
+    static constexpr size_t MIN_FETCH = 1 << 12;
+
+    // client: start generating randomness in the background
+    static void startPool();
+
+    // units of `kind` in the stock of `ch`
+    static size_t available(Kind kind, const Channel &ch);
+
+    // units of `kind` in the stocks of every channel of query slot `slot`
+    static size_t stocked(Kind kind, int slot);
+
+    // client: answer requests of the computing parties until party 0 finishes the operator
+    static void serve();
+
+    // party 0: tell the client that the running operator needs no more randomness
+    static void finish();
+
+    // make sure `count` units of `kind` are in stock, fetching the shortfall in a single request
+    static void reserve(Kind kind, size_t count, const Channel &ch);
+
+    static void andTriples(size_t words, std::vector<uint64_t> &a, std::vector<uint64_t> &b,
+                           std::vector<uint64_t> &c, const Channel &ch);
+
+    static void mulTriples(size_t n, std::vector<uint64_t> &a, std::vector<uint64_t> &b, std::vector<uint64_t> &c,
+                           const Channel &ch);
+
+    // the two passes of a shuffle of `n` rows of `width` words, the first `ints` of which are shared additively
+    // and the others by XOR, party p permuting in pass p
+    static std::vector<Pass> shuffle(size_t n, size_t width, size_t ints, const Channel &ch);
+
+    // `words` random bit words and the additive shares of their 64 * words bits
+    static void randomBits(size_t words, std::vector<uint64_t> &bits, std::vector<uint64_t> &arith,
+                           const Channel &ch);
+};
+
+
+#endif //DEALER_H
@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "secret/Channel.h"
+
+// Cost of the operators run on this rank: time, channel traffic and batched secure operations.
+// An operator is timed by a Scope living as long as it runs. Traffic and operations are counted per query slot,
+// so a Scope only sees those of its own query and not of the queries running beside it.
+// Costs are kept per slot for the last command (EXPLAIN ANALYZE, which runs alone in slot 0) and summed per
+// operator over every session of the rank (`stats`).
+class Profiler {
+public:
+    enum Op {
+        COMPARE,
+        EQUAL,
+        MUX,
+        // single bit AND gates, 64 per word
+        AND,
+        OPS
+    };
+
+    struct Cost {
+        uint64_t calls;
+        int64_t ms;
+        uint64_t rounds;
+        uint64_t bytes;
+        uint64_t messages;
+        uint64_t ops[OPS];
+    };
+
+    class Scope {
+    private:
+        std::string _name;
+        Cost _start{};
+
+    public:
+        explicit Scope(std::string name);
+
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+    };
+
+private:
+    static std::atomic<uint64_t> _ops[Channel::MAX_SLOTS][OPS];
+    static std::mutex _mutex;
+    static std::vector<std::pair<std::string, Cost> > _last[Channel::MAX_SLOTS];
+    static std::map<std::string, Cost> _totals;
+
+public:
+    // `n` elements of the query in the slot of this thread went through `op`
+    static void count(Op op, uint64_t n);
+
+    // forget the operators of the previous command of this thread's slot
+    static void beginCommand();
+
+    // operators of the last command of this thread's slot in the order they finished
+    static nlohmann::json last();
+
+    // every operator of every session
+    static nlohmann::json totals();
+
+private:
+    static Cost now();
+
+    static nlohmann::json toJson(const std::string &name, const Cost &cost);
+};
+
+
+#endif //PROFILER_H
@@ -0,0 +1,25 @@
+#ifndef REVEAL_H
+#define REVEAL_H
+#include <cstdint>
+#include <vector>
+
+#include "basis/Column.h"
+#include "./Channel.h"
+
+// Opens whole result sets to the client at a constant number of rounds.
+// Each computing party sends all of its shares as one buffer packed by Column::pack.
+class Reveal {
+public:
+    // computing party: send the shares of `columns`, which all hold the same number of rows
+    static void send(const std::vector<const Column *> &columns, const Channel &ch);
+
+    // computing party: tell the client that the query could not run, in place of send()
+    static void fail(const Channel &ch);
+
+    // client: reconstruct the columns of `types` sent by both computing parties, values[column][row],
+    // or nothing when a computing party failed
+    static std::vector<std::vector<int64_t> > recv(const std::vector<int> &types, const Channel &ch);
+};
+
+
+#endif //REVEAL_H
@@ -0,0 +1,22 @@
+#ifndef SHARE_H
+#define SHARE_H
+#include <cstdint>
+#include <vector>
+
+#include "basis/Column.h"
+#include "./Channel.h"
+
+// Secret shares whole batches of client values, one buffer per computing party.
+// Integers are shared additively modulo 2^width and booleans by XOR, like mpc_package does.
+class Share {
+public:
+    // client: share values[column][row] of `types` to both computing parties
+    static void send(const std::vector<std::vector<int64_t> > &values, const std::vector<int> &types,
+                     const Channel &ch);
+
+    // computing party: receive the share columns of `types`
+    static std::vector<Column> recv(const std::vector<int> &types, const Channel &ch);
+};
+
+
+#endif //SHARE_H
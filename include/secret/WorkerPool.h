@@ -0,0 +1,58 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./Channel.h"
+
+// Threads of a computing party that run independent slices of a batched operator.
+// Worker `i` owns the channel tagged WORKER_TAG + i, so both parties must start pools of the same size.
+// Workers belong to the query slot of the thread that created the pool.
+class WorkerPool {
+public:
+    static constexpr int MAX_WORKERS = 64;
+
+private:
+    std::vector<std::thread> _threads;
+    std::vector<Channel> _channels;
+    int _slot;
+    std::function<void(int, const Channel &)> _job;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _finish;
+    uint64_t _generation{};
+    int _running{};
+    bool _stop{};
+
+public:
+    explicit WorkerPool(int workers);
+
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    [[nodiscard]] int size() const;
+
+    // Run `job(worker, channel)` on every worker and wait until all of them return.
+    // Worker 0 runs on the calling thread.
+    void run(const std::function<void(int, const Channel &)> &job);
+
+    // Worker count both computing parties agree on. A non-positive request means
+    // as many workers as the smaller of the two machines has cores.
+    static int agreedSize(int requested);
+
+    // agreedSize() of the `workers` setting, `auto` or a count
+    static int agreedSize(const std::string &setting);
+
+private:
+    void loop(int worker);
+};
+
+
+#endif //WORKERPOOL_H
@@ -5,17 +5,58 @@
 #ifndef SMPC_DATABASE_LOCALSERVER_H
 #define SMPC_DATABASE_LOCALSERVER_H
 
-#include <iostream>
-#include <cstring>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "dbms/Scheduler.h"
+#include "dbms/SystemManager.h"
 
 #define PORT 3307
-#define BUFFER_SIZE 1024
 
+// Event driven front end of the client rank.
+// An I/O thread serves every connection with epoll and non-blocking sockets. Messages in both directions
+// are framed as [length u32, big endian][bytes]. Complete commands go to the Scheduler, which runs the
+// commands of each connection in arrival order, and each response is framed back to the connection that sent it.
 class LocalServer {
+public:
+    // larger frames close the connection
+    static constexpr uint32_t MAX_FRAME = 1 << 28;
+
 private:
+    struct Connection {
+        int fd;
+        std::string in;
+        std::string out;
+        // commands queued and not answered yet
+        size_t pending{};
+        // the client closed its side or sent `exit`, the connection closes once every pending response is written
+        bool eof{};
+        // shared with the scheduler, which may still run a command of a closed connection
+        std::shared_ptr<Session> session;
+    };
+
+    int server_fd = -1;
+    int epoll_fd = -1;
+    // wakes the I/O thread when responses are ready
+    int event_fd = -1;
+
+    // owned by the I/O thread
+    std::map<uint64_t, Connection> _connections;
+    uint64_t _nextConnection = 1;
+    std::unique_ptr<Scheduler> _scheduler;
+
+    // set by the shutdown command, the I/O thread returns after writing its response
+    std::atomic<bool> _stopped{};
+
+    std::mutex _mutex;
+    // responses waiting for the I/O thread
+    std::deque<std::pair<uint64_t, std::string> > _responses;
+
     LocalServer();
 
 public:
@@ -27,18 +68,29 @@ public:
 
     LocalServer &operator=(const LocalServer &) = delete;
 
-    void run();
+    // serve the connections on the calling thread, running at most `limit` queries at once
+    void run(int limit = Scheduler::DEFAULT_LIMIT);
 
-    void send_(std::string msg);
+    // frame `msg` back to `connection`
+    void send_(uint64_t connection, std::string msg);
 
 private:
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int addrlen = sizeof(address);
-
     void setupServer();
 
-    std::string processSQLCommand(const std::string &command);
+    void loop();
+
+    void accept_();
+
+    // read what arrived, queue complete frames, returns false once the connection is gone.
+    // Frames that arrived before the end of the stream still run.
+    bool read_(uint64_t id, Connection &c);
+
+    // write what the socket takes, returns false once the connection is gone
+    bool write_(uint64_t id, Connection &c);
+
+    void close_(uint64_t id);
+
+    void watch(int fd, uint64_t id, bool writing, bool add, bool reading = true);
 };
 
 
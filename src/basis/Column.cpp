@@ -0,0 +1,283 @@
+#include "basis/Column.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+BitView::BitView(const uint64_t *words, size_t size) {
+    this->_words = words;
+    this->_size = size;
+}
+
+bool BitView::operator[](size_t i) const {
+    return (_words[i >> 6] >> (i & 63)) & 1;
+}
+
+size_t BitView::size() const {
+    return _size;
+}
+
+const uint64_t *BitView::words() const {
+    return _words;
+}
+
+Column::Column(int type) {
+    this->_type = type;
+}
+
+Column::Column(int type, size_t size, std::vector<uint8_t> data) {
+    this->_type = type;
+    this->_size = size;
+    this->_data = std::move(data);
+}
+
+Column::Column(Column &&other) noexcept {
+    *this = std::move(other);
+}
+
+Column &Column::operator=(Column &&other) noexcept {
+    std::swap(_type, other._type);
+    std::swap(_size, other._size);
+    std::swap(_data, other._data);
+    std::swap(_fd, other._fd);
+    std::swap(_map, other._map);
+    std::swap(_capacity, other._capacity);
+    return *this;
+}
+
+Column::~Column() {
+    if (_map) {
+        munmap(_map, _capacity);
+    }
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+bool Column::open(const std::string &path, size_t size) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < bytes(size)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    void *map = nullptr;
+    if (st.st_size > 0) {
+        map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+    }
+    if (_map) {
+        munmap(_map, _capacity);
+    }
+    if (_fd >= 0) {
+        close(_fd);
+    }
+    this->_data.clear();
+    this->_fd = fd;
+    this->_map = static_cast<uint8_t *>(map);
+    this->_capacity = st.st_size;
+    this->_size = size;
+    return true;
+}
+
+void Column::flush() const {
+    if (_map) {
+        msync(_map, bytes(_size), MS_SYNC);
+    }
+}
+
+const uint8_t *Column::data() const {
+    return _fd >= 0 ? _map : _data.data();
+}
+
+uint8_t *Column::mutableData() {
+    return _fd >= 0 ? _map : _data.data();
+}
+
+void Column::resize(size_t n) {
+    if (_fd < 0) {
+        _data.resize(n, 0);
+        return;
+    }
+    size_t used = bytes(_size);
+    if (n > _capacity) {
+        // double the file so that appends stay amortized O(1)
+        size_t capacity = std::max({n, _capacity * 2, static_cast<size_t>(4096)});
+        if (_map) {
+            munmap(_map, _capacity);
+        }
+        if (ftruncate(_fd, static_cast<off_t>(capacity)) != 0) {
+            throw std::runtime_error("Cannot grow column file.");
+        }
+        void *map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("Cannot map column file.");
+        }
+        _map = static_cast<uint8_t *>(map);
+        _capacity = capacity;
+    }
+    if (n > used) {
+        // the file may hold stale shares past a truncation
+        std::memset(_map + used, 0, n - used);
+    }
+}
+
+int Column::type() const {
+    return _type;
+}
+
+size_t Column::size() const {
+    return _size;
+}
+
+size_t Column::bytes(size_t n) const {
+    if (_type == 1) {
+        // whole words so that the buffer can be read as uint64_t
+        return ((n + 63) >> 6) * sizeof(uint64_t);
+    }
+    return n * (_type >> 3);
+}
+
+void Column::reserve(size_t n) {
+    _data.reserve(bytes(n));
+}
+
+void Column::append(int64_t share) {
+    if (_type == 1) {
+        if ((_size & 63) == 0) {
+            resize(bytes(_size + 1));
+        }
+        if (share & 1) {
+            reinterpret_cast<uint64_t *>(mutableData())[_size >> 6] |= 1ULL << (_size & 63);
+        }
+    } else {
+        size_t offset = bytes(_size);
+        resize(offset + (_type >> 3));
+        // little endian: the low bytes hold the truncated share
+        std::memcpy(mutableData() + offset, &share, _type >> 3);
+    }
+    _size++;
+}
+
+void Column::append(const FieldValue &secret) {
+    std::visit([this](const auto &s) {
+        append(static_cast<int64_t>(s.get()));
+    }, secret);
+}
+
+void Column::append(const Column &other) {
+    if (_type == 1 && (_size & 63) != 0) {
+        // not word aligned, shift bit by bit
+        BitView bits = other.bits();
+        for (size_t i = 0; i < bits.size(); i++) {
+            append(static_cast<int64_t>(bits[i]));
+        }
+        return;
+    }
+    size_t offset = bytes(_size);
+    size_t n = other.bytes(other._size);
+    resize(offset + n);
+    std::memcpy(mutableData() + offset, other.data(), n);
+    _size += other._size;
+}
+
+void Column::truncate(size_t n) {
+    if (n >= _size) {
+        return;
+    }
+    if (_fd < 0) {
+        _data.resize(bytes(n));
+    }
+    if (_type == 1 && (n & 63) != 0) {
+        // appending ORs into the last word, so its unused bits must be clear
+        reinterpret_cast<uint64_t *>(mutableData())[n >> 6] &= (1ULL << (n & 63)) - 1;
+    }
+    _size = n;
+}
+
+bool Column::fits(int64_t v, int type) {
+    if (type == 1) {
+        return v == 0 || v == 1;
+    }
+    if (type == 64) {
+        return true;
+    }
+    int64_t bound = 1LL << (type - 1);
+    return v >= -bound && v < bound;
+}
+
+int64_t Column::get(size_t i) const {
+    switch (_type) {
+        case 1:
+            return bits()[i];
+        case 8:
+            return view<int8_t>()[i];
+        case 16:
+            return view<int16_t>()[i];
+        case 32:
+            return view<int32_t>()[i];
+        default:
+            return view<int64_t>()[i];
+    }
+}
+
+FieldValue Column::secret(size_t i) const {
+    switch (_type) {
+        case 1:
+            return BitSecret(bits()[i]);
+        case 8:
+            return IntSecret(view<int8_t>()[i]);
+        case 16:
+            return IntSecret(view<int16_t>()[i]);
+        case 32:
+            return IntSecret(view<int32_t>()[i]);
+        default:
+            return IntSecret(view<int64_t>()[i]);
+    }
+}
+
+BitView Column::bits() const {
+    return {reinterpret_cast<const uint64_t *>(data()), _size};
+}
+
+std::vector<uint8_t> Column::pack(const std::vector<const Column *> &columns) {
+    uint64_t rows = columns.empty() ? 0 : columns[0]->size();
+    size_t total = sizeof(uint64_t);
+    for (const auto *c: columns) {
+        total += c->bytes(rows);
+    }
+
+    std::vector<uint8_t> buffer(total);
+    std::memcpy(buffer.data(), &rows, sizeof(uint64_t));
+    size_t offset = sizeof(uint64_t);
+    for (const auto *c: columns) {
+        size_t n = c->bytes(rows);
+        std::memcpy(buffer.data() + offset, c->data(), n);
+        offset += n;
+    }
+    return buffer;
+}
+
+std::vector<Column> Column::unpack(const std::vector<uint8_t> &buffer, const std::vector<int> &types) {
+    uint64_t rows;
+    std::memcpy(&rows, buffer.data(), sizeof(uint64_t));
+
+    std::vector<Column> columns;
+    size_t offset = sizeof(uint64_t);
+    for (int t: types) {
+        size_t n = Column(t).bytes(rows);
+        auto begin = buffer.begin() + static_cast<int64_t>(offset);
+        columns.emplace_back(t, rows, std::vector<uint8_t>(begin, begin + static_cast<int64_t>(n)));
+        offset += n;
+    }
+    return columns;
+}
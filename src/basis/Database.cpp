@@ -2,12 +2,14 @@
 // Created by 杜建璋 on 2024/10/25.
 //
 
+#include <filesystem>
 #include <utility>
 
 #include "basis/Database.h"
 
-Database::Database(std::string databaseName) {
+Database::Database(std::string databaseName, std::string dir) {
     this->_databaseName = std::move(databaseName);
+    this->_dir = std::move(dir);
 }
 
 std::string Database::name() {
@@ -21,7 +23,24 @@ Database::createTable(const std::string &tableName, std::vector<std::string> fie
         msg = "Table already exists.";
         return false;
     }
+    if (!_dir.empty()) {
+        // files left by a table of the same name are stale
+        std::filesystem::remove_all(_dir + "/" + tableName);
+    }
+    if (!openTable(tableName, std::move(fieldNames), std::move(fieldTypes), 0)) {
+        msg = "Cannot create table files.";
+        return false;
+    }
+    return true;
+}
+
+bool Database::openTable(const std::string &tableName, std::vector<std::string> fieldNames,
+                         std::vector<int> fieldTypes, size_t size) {
     _tables[tableName] = Table(tableName, std::move(fieldNames), std::move(fieldTypes));
+    if (!_dir.empty() && !_tables[tableName].open(_dir + "/" + tableName, size)) {
+        _tables.erase(tableName);
+        return false;
+    }
     return true;
 }
 
@@ -30,9 +49,21 @@ bool Database::dropTable(const std::string &tableName, std::string &msg) {
         msg = "Table not existed.";
         return false;
     }
+    _tables.erase(tableName);
+    if (!_dir.empty()) {
+        std::filesystem::remove_all(_dir + "/" + tableName);
+    }
     return true;
 }
 
+const std::map<std::string, Table> &Database::tables() const {
+    return _tables;
+}
+
+const std::string &Database::dir() const {
+    return _dir;
+}
+
 Table *Database::getTable(const std::string &tableName) {
     if (_tables.find(tableName) == _tables.end()) {
         return nullptr;
@@ -0,0 +1,29 @@
+#include "basis/Schema.h"
+
+Schema::Schema(std::vector<std::string> fieldNames, std::vector<int> types) {
+    this->_fieldNames = std::move(fieldNames);
+    this->_types = std::move(types);
+}
+
+int Schema::getIdx(const std::string &fieldName) const {
+    for (int i = 0; i < _fieldNames.size(); i++) {
+        if (_fieldNames[i] == fieldName) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+std::shared_ptr<const Schema> Schema::insert(int idx, const std::string &fieldName, int type) const {
+    auto ret = std::make_shared<Schema>(*this);
+    ret->_fieldNames.insert(ret->_fieldNames.begin() + idx, fieldName);
+    ret->_types.insert(ret->_types.begin() + idx, type);
+    return ret;
+}
+
+std::shared_ptr<const Schema> Schema::erase(int idx) const {
+    auto ret = std::make_shared<Schema>(*this);
+    ret->_fieldNames.erase(ret->_fieldNames.begin() + idx);
+    ret->_types.erase(ret->_types.begin() + idx);
+    return ret;
+}
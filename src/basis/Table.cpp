@@ -2,6 +2,9 @@
 // Created by 杜建璋 on 2024/10/25.
 //
 
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
 #include <utility>
 
 #include "basis/Table.h"
@@ -13,28 +16,141 @@
 
 Table::Table(std::string tableName, std::vector<std::string> fieldNames, std::vector<int> fieldTypes) {
     this->_tableName = std::move(tableName);
-    this->_fieldNames = std::move(fieldNames);
-    this->_fieldTypes = std::move(fieldTypes);
+    this->_schema = std::make_shared<const Schema>(std::move(fieldNames), std::move(fieldTypes));
+    for (int t: this->_schema->_types) {
+        this->_columns.emplace_back(t);
+    }
+}
+
+bool Table::open(const std::string &dir, size_t size) {
+    std::filesystem::create_directories(dir);
+    for (int i = 0; i < _columns.size(); i++) {
+        if (!_columns[i].open(dir + "/" + std::to_string(i) + ".col", size)) {
+            return false;
+        }
+    }
+    _size = size;
+    return true;
+}
+
+void Table::flush() const {
+    for (const auto &c: _columns) {
+        c.flush();
+    }
+}
+
+const std::string &Table::name() const {
+    return _tableName;
 }
 
 bool Table::insert(const TableRecord& r) {
-    this->_records.push_back(r);
+    if (r._fieldValues.size() != _columns.size()) {
+        return false;
+    }
+    for (int i = 0; i < _columns.size(); i++) {
+        _columns[i].append(r._fieldValues[i]);
+    }
+    _size++;
     return true;
 }
 
-const std::vector<int> &Table::fieldTypes() {
-    return _fieldTypes;
+bool Table::insert(const std::vector<Column> &batch) {
+    if (batch.size() != _columns.size()) {
+        return false;
+    }
+    for (int i = 0; i < _columns.size(); i++) {
+        _columns[i].append(batch[i]);
+    }
+    _size += batch.empty() ? 0 : batch[0].size();
+    return true;
+}
+
+void Table::truncate(size_t n) {
+    for (auto &c: _columns) {
+        c.truncate(n);
+    }
+    _size = std::min(_size, n);
+}
+
+const std::vector<int> &Table::fieldTypes() const {
+    return _schema->_types;
+}
+
+const std::shared_ptr<const Schema> &Table::schema() const {
+    return _schema;
+}
+
+size_t Table::size() const {
+    return _size;
+}
+
+const Column &Table::column(int idx) const {
+    return _columns[idx];
+}
+
+BitView Table::bitColumnView(int idx) const {
+    return _columns[idx].bits();
+}
+
+template<typename T>
+void fillColumnT(std::vector<TempRecord> &records, std::span<const T> view) {
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i]._fieldValues.emplace_back(IntSecret<T>(view[i]));
+    }
 }
 
 std::vector<TempRecord> Table::selectAll() const {
-    std::vector<TempRecord> ret;
-    for (const auto& r : this->_records) {
-        ret.push_back(r.convertToTemp());
+    std::vector<int> fields(_columns.size());
+    std::iota(fields.begin(), fields.end(), 0);
+    return select(fields);
+}
+
+std::vector<TempRecord> Table::select(const std::vector<int> &fields) const {
+    // the records of every field share the schema of the table
+    auto schema = _schema;
+    if (fields.size() != _columns.size() || !std::ranges::is_sorted(fields)) {
+        std::vector<std::string> names;
+        std::vector<int> types;
+        for (int c: fields) {
+            names.push_back(fieldNames()[c]);
+            types.push_back(fieldTypes()[c]);
+        }
+        schema = std::make_shared<const Schema>(std::move(names), std::move(types));
+    }
+    std::vector<TempRecord> ret(_size);
+    for (auto &r: ret) {
+        r._schema = schema;
+        r._fieldValues.reserve(fields.size());
+    }
+
+    // walk column by column so that every share buffer is scanned sequentially
+    for (int c: fields) {
+        switch (fieldTypes()[c]) {
+            case 1: {
+                BitView bits = bitColumnView(c);
+                for (size_t i = 0; i < _size; i++) {
+                    ret[i]._fieldValues.emplace_back(BitSecret(bits[i]));
+                }
+                break;
+            }
+            case 8:
+                fillColumnT(ret, columnView<int8_t>(c));
+                break;
+            case 16:
+                fillColumnT(ret, columnView<int16_t>(c));
+                break;
+            case 32:
+                fillColumnT(ret, columnView<int32_t>(c));
+                break;
+            default:
+                fillColumnT(ret, columnView<int64_t>(c));
+                break;
+        }
     }
     return ret;
 }
 
 const std::vector<std::string> &Table::fieldNames() const {
-    return _fieldNames;
+    return _schema->_fieldNames;
 }
 
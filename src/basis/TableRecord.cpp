@@ -16,8 +16,7 @@ Table *TableRecord::owner() const {
 TempRecord TableRecord::convertToTemp() const {
     TempRecord t;
     t._fieldValues = _fieldValues;
-    t._fieldNames = _owner->fieldNames();
-    t._types = _owner->fieldTypes();
+    t._schema = _owner->schema();
     return t;
 }
 
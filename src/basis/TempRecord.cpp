@@ -9,20 +9,17 @@
 #include "../../include/basis/TempRecord.h"
 
 int TempRecord::getType(int valueIdx) const {
-    return _types[valueIdx];
+    return _schema->_types[valueIdx];
 }
 
 void TempRecord::addType(int type) {
-    _types.push_back(type);
+    static const Schema empty;
+    const Schema &s = _schema ? *_schema : empty;
+    _schema = s.insert(static_cast<int>(s._types.size()), "", type);
 }
 
 int TempRecord::getIdx(const std::string &fieldName) const {
-    for (int i = 0; i < _fieldNames.size(); i++) {
-        if (_fieldNames[i] == fieldName) {
-            return i;
-        }
-    }
-    return -1;
+    return _schema->getIdx(fieldName);
 }
 
 template<typename T>
@@ -52,3 +49,20 @@ BitSecret TempRecord::compareField(const TempRecord &other, const std::string &f
             return compareFieldsT<int64_t>(_fieldValues, other._fieldValues, idx);
     }
 }
+
+uint64_t TempRecord::share(int idx) const {
+    return std::visit([](const auto &s) {
+        return static_cast<uint64_t>(static_cast<int64_t>(s.get()));
+    }, _fieldValues[idx]);
+}
+
+void TempRecord::setShare(int idx, uint64_t share) {
+    _fieldValues[idx] = std::visit([share](const auto &s) -> FieldValue {
+        using S = std::decay_t<decltype(s)>;
+        if constexpr (std::is_same_v<S, BitSecret>) {
+            return BitSecret(share & 1);
+        } else {
+            return S(static_cast<decltype(s.get())>(share));
+        }
+    }, _fieldValues[idx]);
+}
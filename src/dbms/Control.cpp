@@ -0,0 +1,60 @@
+#include "dbms/Control.h"
+
+#include <cstring>
+#include <mpc_package/utils/Comm.h>
+
+#include "secret/Channel.h"
+
+std::mutex Control::_mutex;
+uint64_t Control::_sent = 0;
+uint64_t Control::_acked[2] = {0, 0};
+
+uint64_t Control::send(int type, const nlohmann::json &payload) {
+    // both parties must see the commands in the same order
+    std::lock_guard lock(_mutex);
+    uint64_t seq = ++_sent;
+    std::vector<uint8_t> m(sizeof(uint64_t) + 1);
+    std::memcpy(m.data(), &seq, sizeof(uint64_t));
+    m[sizeof(uint64_t)] = static_cast<uint8_t>(type);
+    if (!payload.is_null()) {
+        auto body = nlohmann::json::to_msgpack(payload);
+        m.insert(m.end(), body.begin(), body.end());
+    }
+
+    Channel ch(CONTROL_TAG);
+    ch.send(m, 0);
+    ch.send(m, 1);
+    drain(MAX_IN_FLIGHT);
+    return seq;
+}
+
+void Control::sync() {
+    std::lock_guard lock(_mutex);
+    drain(0);
+}
+
+Control::Command Control::recv() {
+    auto m = Channel(CONTROL_TAG).recv<uint8_t>(Comm::CLIENT_RANK);
+    Command c{};
+    std::memcpy(&c.seq, m.data(), sizeof(uint64_t));
+    c.type = m[sizeof(uint64_t)];
+    if (m.size() > sizeof(uint64_t) + 1) {
+        c.payload = nlohmann::json::from_msgpack(m.begin() + sizeof(uint64_t) + 1, m.end());
+    }
+    return c;
+}
+
+void Control::ack(uint64_t seq) {
+    std::vector<uint64_t> m = {seq};
+    Channel(ACK_TAG).send(m, Comm::CLIENT_RANK);
+}
+
+void Control::drain(uint64_t inFlight) {
+    Channel ch(ACK_TAG);
+    for (int r = 0; r < 2; r++) {
+        while (_acked[r] < _sent && (_sent - _acked[r] > inFlight || ch.pending(r))) {
+            (void) ch.recv<uint64_t>(r);
+            _acked[r]++;
+        }
+    }
+}
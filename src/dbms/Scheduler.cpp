@@ -0,0 +1,103 @@
+#include "dbms/Scheduler.h"
+
+#include <algorithm>
+
+#include "secret/Channel.h"
+
+Scheduler::Scheduler(int limit) {
+    limit = std::clamp(limit, 1, Channel::MAX_SLOTS);
+    this->_slots.resize(limit);
+    SystemManager::getInstance()._querySlots = limit;
+    for (int i = 0; i < limit; i++) {
+        _threads.emplace_back(&Scheduler::loop, this, i);
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    for (auto &t: _threads) {
+        t.join();
+    }
+}
+
+void Scheduler::submit(uint64_t id, const std::shared_ptr<Session> &session, std::string command, Respond respond) {
+    std::lock_guard lock(_mutex);
+    _queues[id].push_back({session, std::move(command), std::move(respond)});
+    dispatch();
+}
+
+void Scheduler::dispatch() {
+    if (_exclusive) {
+        return;
+    }
+
+    // sessions in turn, starting after the one served last
+    std::vector<uint64_t> order;
+    for (auto it = _queues.upper_bound(_turn); it != _queues.end(); ++it) {
+        order.push_back(it->first);
+    }
+    for (auto it = _queues.begin(); it != _queues.end() && it->first <= _turn; ++it) {
+        order.push_back(it->first);
+    }
+
+    for (uint64_t id: order) {
+        if (_busy.contains(id)) {
+            continue;
+        }
+        const Pending &next = _queues.at(id).front();
+        if (!SystemManager::shared(next.command, *next.session)) {
+            // later commands do not overtake it, so it runs as soon as the running ones finished
+            if (_busy.empty()) {
+                _exclusive = true;
+                start(id, 0);
+            }
+            return;
+        }
+        // the lowest free slot, `preprocess` stocks every slot so it does not matter which one a query gets
+        auto free = std::ranges::find_if(_slots, [](const Running &r) { return !r.active; });
+        if (free == _slots.end()) {
+            return;
+        }
+        start(id, static_cast<int>(free - _slots.begin()));
+    }
+}
+
+void Scheduler::start(uint64_t id, int slot) {
+    auto it = _queues.find(id);
+    _slots[slot] = {id, std::move(it->second.front()), true};
+    it->second.pop_front();
+    if (it->second.empty()) {
+        _queues.erase(it);
+    }
+    _busy.insert(id);
+    _turn = id;
+    _changed.notify_all();
+}
+
+void Scheduler::loop(int slot) {
+    Channel::bind(slot);
+    while (true) {
+        Pending p;
+        {
+            std::unique_lock lock(_mutex);
+            _changed.wait(lock, [this, slot] { return _stop || _slots[slot].active; });
+            if (_stop) {
+                return;
+            }
+            p = std::move(_slots[slot].pending);
+        }
+
+        p.respond(SystemManager::getInstance().clientExecute(p.command, *p.session));
+
+        std::lock_guard lock(_mutex);
+        _slots[slot].active = false;
+        _busy.erase(_slots[slot].id);
+        // an exclusive command runs alone, so whatever finished ends it
+        _exclusive = false;
+        dispatch();
+    }
+}
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <filesystem>
 #include <limits>
 #include <iomanip>
 #include <SQLParser.h>
@@ -15,57 +16,100 @@
 
 #include "basis/TableRecord.h"
 #include "basis/TempRecord.h"
-#include "socket/LocalServer.h"
 #include <mpc_package/utils/System.h>
 
 #include "operator/Select.h"
 #include "operator/Insert.h"
 #include "operator/Create.h"
 #include "operator/Drop.h"
+#include "operator/Load.h"
+#include "dbms/Control.h"
+#include "secret/Batch.h"
+#include "secret/Dealer.h"
+#include "secret/Profiler.h"
+#include "secret/Reveal.h"
+#include "secret/WorkerPool.h"
 
 using json = nlohmann::json;
 
-SystemManager::CommandType SystemManager::getCommandType(const std::string &prefix) {
-    static const std::unordered_map<std::string, SystemManager::CommandType> typeMap = {
-        {"exit", EXIT},
-        {"cdb", CREATE_DB},
-        {"ddb", DROP_DB},
-        {"udb", USE_DB},
-        {"ctb", CREATE_TABLE},
-        {"dtb", DROP_TABLE},
-        {"ins", INSERT},
-        {"sel", SELECT}
-    };
-    auto it = typeMap.find(prefix);
-    return (it != typeMap.end()) ? it->second : SystemManager::UNKNOWN;
-}
-
-std::string SystemManager::getCommandPrefix(CommandType type) {
-    static const std::unordered_map<CommandType, std::string> typeMap = {
-        {EXIT, "exit"},
-        {CREATE_DB, "cdb"},
-        {DROP_DB, "ddb"},
-        {USE_DB, "udb"},
-        {CREATE_TABLE, "ctb"},
-        {DROP_TABLE, "dtb"},
-        {INSERT, "ins"},
-        {SELECT, "sel"}
-    };
-    auto it = typeMap.find(type);
-    return (it != typeMap.end()) ? it->second : "exit";
-}
+thread_local Database *SystemManager::_currentDatabase = nullptr;
+thread_local std::map<std::string, std::string> SystemManager::_settings = Session().settings;
 
 SystemManager &SystemManager::getInstance() {
     static SystemManager instance;
     return instance;
 }
 
+void SystemManager::open(const std::string &dataDir) {
+    _dataDir = dataDir;
+    std::filesystem::create_directories(dataDir);
+    std::ifstream in(dataDir + "/catalog.json");
+    if (!in) {
+        return;
+    }
+
+    // only the catalog is read, share files are mapped as they are
+    std::stringstream text;
+    text << in.rdbuf();
+    json catalog = json::parse(text.str());
+    for (const auto &db: catalog.at("databases")) {
+        std::string dbName = db.at("name").get<std::string>(), msg;
+        createDatabase(dbName, msg);
+        for (const auto &t: db.at("tables")) {
+            std::string tbName = t.at("name").get<std::string>();
+            if (!_databases[dbName].openTable(tbName, t.at("fieldNames").get<std::vector<std::string> >(),
+                                              t.at("fieldTypes").get<std::vector<int> >(),
+                                              t.at("size").get<size_t>())) {
+                std::cerr << "Cannot open table `" << dbName << "." << tbName << "`." << std::endl;
+            }
+        }
+    }
+}
+
+void SystemManager::save() const {
+    for (const auto &[dbName, db]: _databases) {
+        for (const auto &[tbName, t]: db.tables()) {
+            t.flush();
+        }
+    }
+    saveCatalog();
+}
+
+void SystemManager::saveCatalog() const {
+    if (_dataDir.empty()) {
+        return;
+    }
+    json catalog;
+    catalog["databases"] = json::array();
+    for (const auto &[dbName, db]: _databases) {
+        json d;
+        d["name"] = dbName;
+        d["tables"] = json::array();
+        for (const auto &[tbName, t]: db.tables()) {
+            json tj;
+            tj["name"] = tbName;
+            tj["fieldNames"] = t.fieldNames();
+            tj["fieldTypes"] = t.fieldTypes();
+            tj["size"] = t.size();
+            d["tables"].push_back(tj);
+        }
+        catalog["databases"].push_back(d);
+    }
+
+    // replace the catalog at once so that a crash leaves either version
+    std::string path = _dataDir + "/catalog.json";
+    std::ofstream(path + ".tmp") << catalog.dump();
+    std::filesystem::rename(path + ".tmp", path);
+}
+
 bool SystemManager::createDatabase(const std::string &dbName, std::string &msg) {
     if (_databases.find(dbName) != _databases.end()) {
         msg = "Database " + dbName + " already exists.";
         return false;
     }
-    _databases[dbName] = Database(dbName);
+    // the client keeps the catalog only
+    std::string dir = _dataDir.empty() || Comm::rank() == Comm::CLIENT_RANK ? "" : _dataDir + "/" + dbName;
+    _databases[dbName] = Database(dbName, dir);
     return true;
 }
 
@@ -73,7 +117,16 @@ bool SystemManager::dropDatabase(const std::string &dbName, std::string &msg) {
     if (_currentDatabase && _currentDatabase->name() == dbName) {
         _currentDatabase = nullptr;
     }
-    if (_databases.erase(dbName) > 0) {
+    if (_serversDatabase == dbName) {
+        _serversDatabase.clear();
+    }
+    auto it = _databases.find(dbName);
+    if (it != _databases.end()) {
+        std::string dir = it->second.dir();
+        _databases.erase(it);
+        if (!dir.empty()) {
+            std::filesystem::remove_all(dir);
+        }
         return true;
     }
     msg = "Database " + dbName + " does not exist.";
@@ -116,15 +169,13 @@ std::string handleEndingDatabaseName(std::istringstream &iss, std::ostringstream
     return dbName;
 }
 
-void SystemManager::notifyServersSync(json &j) {
-    int done;
-    std::string m = j.dump();
-    Comm::send(&m, 0);
-    Comm::send(&m, 1);
+uint64_t SystemManager::notifyServers(CommandType type, const json &j) {
+    return Control::send(type, j);
+}
 
-    // sync
-    Comm::recv(&done, 0);
-    Comm::recv(&done, 1);
+void SystemManager::notifyServersSync(CommandType type, const json &j) {
+    Control::send(type, j);
+    Control::sync();
 }
 
 // return if is create table
@@ -147,9 +198,8 @@ bool SystemManager::clientCreateDeleteDb(std::istringstream &iss, std::ostringst
             }
             // notify servers
             json j;
-            j["type"] = getCommandPrefix(CREATE_DB);
             j["name"] = dbName;
-            notifyServersSync(j);
+            notifyServers(CREATE_DB, j);
 
             resp << "OK. Database `" + dbName + "` created." << std::endl;
         } else {
@@ -161,9 +211,8 @@ bool SystemManager::clientCreateDeleteDb(std::istringstream &iss, std::ostringst
 
             // notify servers
             json j;
-            j["type"] = getCommandPrefix(DROP_DB);
             j["name"] = dbName;
-            notifyServersSync(j);
+            notifyServers(DROP_DB, j);
 
             resp << "OK. Database " + dbName + " dropped." << std::endl;
         }
@@ -181,15 +230,224 @@ void SystemManager::clientUseDb(std::istringstream &iss, std::ostringstream &res
     }
     // notify servers
     json j;
-    j["type"] = getCommandPrefix(USE_DB);
     j["name"] = dbName;
-    notifyServersSync(j);
+    notifyServers(USE_DB, j);
+    _serversDatabase = dbName;
 
     resp << "OK. Database `" + dbName + "` selected." << std::endl;
 }
 
-void SystemManager::clientExecute(const std::string &command) {
+void SystemManager::clientSet(std::istringstream &iss, std::ostringstream &resp) {
+    static const std::map<std::string, std::vector<std::string> > options = {
+        {"sort_mode", {"batched", "sequential", "shuffle", "key_only"}},
+        {"sort_network", {"odd_even", "bitonic"}},
+        {"compaction", {"exact", "padded", "off"}},
+        {"workers", {"auto"}}
+    };
+    // settings that also take a positive number
+    static const std::vector<std::string> numeric = {"workers"};
+
+    std::string name, value;
+    iss >> name >> value;
+    if (!value.empty() && value.back() == ';') {
+        value.pop_back();
+    }
+    std::ranges::transform(name, name.begin(), ::tolower);
+    std::ranges::transform(value, value.begin(), ::tolower);
+
+    auto it = options.find(name);
+    if (it == options.end()) {
+        resp << "Failed. Unknown setting `" + name + "`." << std::endl;
+        return;
+    }
+    bool isNumber = !value.empty() && value.size() < 10 && std::ranges::all_of(value, ::isdigit) && std::stoi(value) > 0;
+    if (std::ranges::find(it->second, value) == it->second.end()
+        && !(isNumber && std::ranges::find(numeric, name) != numeric.end())) {
+        resp << "Failed. Invalid value `" + value + "` for `" + name + "`." << std::endl;
+        return;
+    }
+    _settings[name] = value;
+    resp << "OK. `" + name + "` set to `" + value + "`." << std::endl;
+}
+
+void SystemManager::clientPreprocess(std::istringstream &iss, std::ostringstream &resp) {
+    std::string count, width = "64";
+    iss >> count;
+    if (!(iss >> width)) {
+        width = "64";
+    }
+    for (auto *s: {&count, &width}) {
+        if (!s->empty() && s->back() == ';') {
+            s->pop_back();
+        }
+    }
+    if (count.empty() || count.size() > 12 || !std::ranges::all_of(count, ::isdigit)) {
+        resp << "Failed. Syntax error: Expected `preprocess <n> [width]`." << std::endl;
+        return;
+    }
+    if (width != "1" && width != "8" && width != "16" && width != "32" && width != "64") {
+        resp << "Failed. Invalid width `" + width + "`." << std::endl;
+        return;
+    }
+
+    json j;
+    j["count"] = std::stoull(count);
+    j["width"] = std::stoi(width);
+    j["workers"] = _settings["workers"];
+    j["slots"] = _querySlots;
+    notifyServers(PREPROCESS, j);
+
+    Dealer::serve();
+    resp << "OK. Randomness for " + count + " comparisons of width " + width + " preprocessed in each of "
+            + std::to_string(_querySlots) + " query slots." << std::endl;
+}
+
+void SystemManager::serverPreprocess(json &j) {
+    size_t n = j.at("count").get<size_t>();
+    int width = j.at("width").get<int>();
+    int pool = WorkerPool::agreedSize(j.at("workers").get<std::string>());
+    int slots = j.at("slots").get<int>();
+
+    // the default channel serves whole-column operators, worker channels split the comparators of a sort
+    std::vector<std::pair<int, size_t> > channels = {{Channel::DEFAULT_TAG, n}};
+    for (int i = 0; i < pool; i++) {
+        channels.emplace_back(Channel::WORKER_TAG + i, (n + pool - 1) / pool);
+    }
+    // a query runs in whichever slot is free, so every slot gets its stock
+    for (int s = 0; s < slots; s++) {
+        for (auto [tag, count]: channels) {
+            Channel ch = Channel::exact(tag + s * Channel::SLOT_TAGS);
+            if (width > 1) {
+                Dealer::reserve(Dealer::AND_TRIPLES, Batch::lessThanWords(width, count), ch);
+            }
+            Dealer::reserve(Dealer::MUL_TRIPLES, count, ch);
+            Dealer::reserve(Dealer::RANDOM_BITS, Batch::words(count), ch);
+        }
+    }
+    Dealer::finish();
+}
+
+static json statsJson() {
+    auto t = Channel::traffic();
+    json j;
+    j["rank"] = Comm::rank();
+    j["bytes"] = t.bytes;
+    j["messages"] = t.messages;
+    j["rounds"] = t.rounds;
+    j["operators"] = Profiler::totals();
+    j["last"] = Profiler::last();
+    j["stock"] = json::array();
+    for (int s = 0; s < Channel::MAX_SLOTS; s++) {
+        size_t ands = Dealer::stocked(Dealer::AND_TRIPLES, s);
+        size_t mul = Dealer::stocked(Dealer::MUL_TRIPLES, s);
+        size_t bits = Dealer::stocked(Dealer::RANDOM_BITS, s);
+        if (ands + mul + bits > 0) {
+            j["stock"].push_back({{"slot", s}, {"and", ands}, {"mul", mul}, {"bits", bits}});
+        }
+    }
+    return j;
+}
+
+// one line per operator of every rank
+static void printCosts(std::ostringstream &resp, const json &stats, const std::string &key) {
+    static const std::vector<std::string> columns = {
+        "calls", "ms", "rounds", "bytes", "messages", "compare", "equal", "mux", "and"
+    };
+    resp << std::setw(10) << "operator" << std::setw(6) << "rank";
+    for (const auto &c: columns) {
+        resp << std::setw(c == "bytes" ? 14 : 10) << c;
+    }
+    resp << std::endl;
+    for (const auto &rank: stats) {
+        for (const auto &op: rank.at(key)) {
+            resp << std::setw(10) << op.at("operator").get<std::string>() << std::setw(6) << rank.at("rank").get<int>();
+            for (const auto &c: columns) {
+                resp << std::setw(c == "bytes" ? 14 : 10) << op.at(c).get<int64_t>();
+            }
+            resp << std::endl;
+        }
+    }
+}
+
+json SystemManager::collectStats() {
+    // the servers reply once every earlier command finished
+    notifyServers(STATS, json());
+
+    json ret = json::array();
+    for (int r = 0; r < 2; r++) {
+        ret.push_back(json::from_msgpack(Channel().recv<uint8_t>(r)));
+    }
+    ret.push_back(statsJson());
+    return ret;
+}
+
+void SystemManager::clientStats(std::ostringstream &resp) {
+    resp << std::setw(10) << "rank" << std::setw(16) << "bytes" << std::setw(12) << "messages"
+            << std::setw(12) << "rounds" << std::endl;
+    json stats = collectStats();
+    for (const auto &t: stats) {
+        resp << std::setw(10) << t.at("rank").get<int>() << std::setw(16) << t.at("bytes").get<uint64_t>()
+                << std::setw(12) << t.at("messages").get<uint64_t>() << std::setw(12) << t.at("rounds").get<uint64_t>()
+                << std::endl;
+    }
+    resp << std::endl;
+    printCosts(resp, stats, "operators");
+
+    // preprocessed randomness left on the computing parties, per query slot
+    resp << std::endl << std::setw(10) << "rank" << std::setw(6) << "slot" << std::setw(14) << "and"
+            << std::setw(14) << "mul" << std::setw(14) << "bits" << std::endl;
+    for (const auto &rank: stats) {
+        for (const auto &s: rank.at("stock")) {
+            resp << std::setw(10) << rank.at("rank").get<int>() << std::setw(6) << s.at("slot").get<int>()
+                    << std::setw(14) << s.at("and").get<size_t>() << std::setw(14) << s.at("mul").get<size_t>()
+                    << std::setw(14) << s.at("bits").get<size_t>() << std::endl;
+        }
+    }
+}
+
+void SystemManager::clientExplainAnalyze(const std::string &query, std::ostringstream &resp) {
+    std::string result = clientExecute(query);
+    if (result.starts_with("Failed")) {
+        resp << result.substr(0, result.find('\n') + 1);
+        return;
+    }
+    printCosts(resp, collectStats(), "last");
+}
+
+void SystemManager::shutdown() {
+    json j;
+    j["shutdown"] = true;
+    notifyServersSync(EXIT, j);
+}
+
+std::string SystemManager::clientExecute(const std::string &command, Session &session) {
+    auto it = _databases.find(session.database);
+    _currentDatabase = it == _databases.end() ? nullptr : &it->second;
+    _settings = session.settings;
+    // a shared query names its database itself, the others run alone and may switch the servers
+    if (!shared(command, session) && _currentDatabase && session.database != _serversDatabase) {
+        json j;
+        j["name"] = session.database;
+        notifyServers(USE_DB, j);
+        _serversDatabase = session.database;
+    }
+
+    std::string resp = clientExecute(command);
+    session.database = _currentDatabase ? _currentDatabase->name() : "";
+    session.settings = _settings;
+    return resp;
+}
+
+bool SystemManager::shared(const std::string &command, const Session &session) {
+    std::istringstream iss(command);
+    std::string word;
+    iss >> word;
+    return strcasecmp(word.c_str(), "select") == 0 && session.settings.at("sort_mode") != "sequential";
+}
+
+std::string SystemManager::clientExecute(const std::string &command) {
     int64_t start = System::currentTimeMillis();
+    Profiler::beginCommand();
     std::istringstream iss(command);
     std::string word;
     iss >> word;
@@ -209,12 +467,56 @@ void SystemManager::clientExecute(const std::string &command) {
         goto over;
     }
 
+    if (strcasecmp(word.c_str(), "set") == 0) {
+        clientSet(iss, resp);
+        goto over;
+    }
+
+    if (strcasecmp(word.c_str(), "preprocess") == 0) {
+        clientPreprocess(iss, resp);
+        goto over;
+    }
+
+    if (strcasecmp(word.c_str(), "stats") == 0 || strcasecmp(word.c_str(), "stats;") == 0) {
+        clientStats(resp);
+        goto over;
+    }
+
+    if (strcasecmp(word.c_str(), "shutdown") == 0 || strcasecmp(word.c_str(), "shutdown;") == 0) {
+        shutdown();
+        resp << "OK. Servers stopped." << std::endl;
+        goto over;
+    }
+
+    if (strcasecmp(word.c_str(), "explain") == 0) {
+        std::string analyze;
+        iss >> analyze;
+        if (strcasecmp(analyze.c_str(), "analyze") != 0) {
+            resp << "Failed. Syntax error: Expected `explain analyze <query>`." << std::endl;
+            goto over;
+        }
+        std::string query;
+        std::getline(iss, query);
+        clientExplainAnalyze(query, resp);
+        goto over;
+    }
+
     if (!_currentDatabase) {
         resp << "Failed. No database selected." << std::endl;
         goto over;
     }
 
+    if (strcasecmp(word.c_str(), "load") == 0) {
+        Load::clientLoad(resp, iss);
+        goto over;
+    }
+
     if (!result.isValid()) {
+        // the SQL parser only accepts a single VALUES tuple
+        if (strcasecmp(word.c_str(), "insert") == 0) {
+            Insert::clientInsertRows(resp, command);
+            goto over;
+        }
         resp << "Failed. " << result.errorMsg() << std::endl;
         goto over;
     }
@@ -245,25 +547,66 @@ void SystemManager::clientExecute(const std::string &command) {
         }
     }
 over:
+    if (create || drop) {
+        save();
+    }
     resp << "(" << System::currentTimeMillis() - start << " ms)" << std::endl;
-    LocalServer::getInstance().send_(resp.str());
+    return resp.str();
 }
 
-void SystemManager::log(const std::string &msg, bool success) {
-    LocalServer::getInstance().send_((success ? "OK. " : "Failed. ") + msg + "\n");
+void SystemManager::serverQuery(std::vector<std::thread> &slots, uint64_t seq, json j) {
+    int slot = j.at("slot").get<int>();
+    // the client reuses a slot once its query was revealed, only the acknowledgement may be left
+    if (slots[slot].joinable()) {
+        slots[slot].join();
+    }
+    auto it = _databases.find(j.at("database").get<std::string>());
+    Database *db = it == _databases.end() ? nullptr : &it->second;
+    slots[slot] = std::thread([slot, seq, db, j = std::move(j)] {
+        Channel::bind(slot);
+        Profiler::beginCommand();
+        _currentDatabase = db;
+        if (db) {
+            Select::serverSelect(j);
+        } else {
+            std::cerr << "Unknown database `" << j.at("database").get<std::string>() << "`." << std::endl;
+            Dealer::finish();
+            Reveal::fail(Channel());
+        }
+        Control::ack(seq);
+    });
 }
 
 void SystemManager::serverExecute() {
+    // thread of the query running in each slot
+    std::vector<std::thread> slots(Channel::MAX_SLOTS);
     while (true) {
-        std::string jstr;
-        Comm::recv(&jstr, Comm::CLIENT_RANK);
-        auto j = json::parse(jstr);
-        std::string type = j.at("type").get<std::string>();
-        auto commandType = getCommandType(type);
+        auto command = Control::recv();
+        auto &j = command.payload;
+        auto commandType = static_cast<CommandType>(command.type);
+        // a query forgets the operators of its slot once it runs there
+        if (commandType != STATS && commandType != SELECT) {
+            Profiler::beginCommand();
+        }
+        if (commandType == SELECT) {
+            serverQuery(slots, command.seq, std::move(j));
+            continue;
+        }
+
+        // any other command runs alone
+        for (auto &t: slots) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
 
         switch (commandType) {
             case EXIT: {
-                Comm::send(&done, Comm::CLIENT_RANK);
+                if (j.contains("shutdown")) {
+                    save();
+                    Control::ack(command.seq);
+                    return;
+                }
                 break;
             }
             case CREATE_DB: {
@@ -297,16 +640,34 @@ void SystemManager::serverExecute() {
                 Insert::serverInsert(j);
                 break;
             }
-            case SELECT: {
-                Select::serverSelect(j);
+            case LOAD: {
+                Load::serverLoad(j);
                 break;
             }
-            case UNKNOWN: {
-                std::cerr << "Unknown command type: " << type << std::endl;
+            case PREPROCESS: {
+                serverPreprocess(j);
                 break;
             }
+            case STATS: {
+                Channel().send(json::to_msgpack(statsJson()), Comm::CLIENT_RANK);
+                break;
+            }
+            default: {
+                std::cerr << "Unknown command type: " << command.type << std::endl;
+                break;
+            }
+        }
+        if (commandType == CREATE_DB || commandType == DROP_DB || commandType == CREATE_TABLE
+            || commandType == DROP_TABLE) {
+            save();
+        }
+        // only the table that grew is flushed before its row count is written
+        if (commandType == INSERT || commandType == LOAD) {
+            if (const Table *table = _currentDatabase->getTable(j.at("name").get<std::string>())) {
+                table->flush();
+            }
+            saveCatalog();
         }
-        // sync
-        Comm::send(&done, Comm::CLIENT_RANK);
+        Control::ack(command.seq);
     }
 }
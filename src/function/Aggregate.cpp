@@ -0,0 +1,484 @@
+#include "function/Aggregate.h"
+
+#include <map>
+#include <mpc_package/utils/Comm.h>
+
+#include "function/Order.h"
+#include "secret/Batch.h"
+
+using json = nlohmann::json;
+
+bool Aggregate::contains(const std::vector<hsql::Expr *> *selectList) {
+    return std::ranges::any_of(*selectList, [](const hsql::Expr *e) {
+        return e->type == hsql::kExprFunctionRef;
+    });
+}
+
+bool Aggregate::encode(std::ostringstream &resp, const std::vector<hsql::Expr *> *selectList, const Table *table,
+                       const std::vector<std::string> &groupFields, json &out, std::vector<std::string> &labels) {
+    static const std::vector<std::string> functions = {"count", "sum", "min", "max", "avg"};
+    const auto &fieldNames = table->fieldNames();
+    out = json::array();
+    for (const auto *e: *selectList) {
+        if (e->type == hsql::kExprColumnRef && std::ranges::find(groupFields, e->getName()) != groupFields.end()) {
+            // grouping fields are checked by the caller
+            int idx = static_cast<int>(std::distance(fieldNames.begin(), std::ranges::find(fieldNames, e->getName())));
+            out.push_back({{"fn", "key"}, {"field", idx}, {"width", table->fieldTypes()[idx]}});
+            labels.emplace_back(e->getName());
+            continue;
+        }
+        if (e->type == hsql::kExprColumnRef) {
+            resp << "Failed. Field `" << e->getName() << "` is neither grouped nor aggregated." << std::endl;
+            return false;
+        }
+        if (e->type != hsql::kExprFunctionRef) {
+            resp << "Failed. Unsupported select list with aggregates." << std::endl;
+            return false;
+        }
+        std::string fn = e->name;
+        std::ranges::transform(fn, fn.begin(), ::tolower);
+        if (std::ranges::find(functions, fn) == functions.end()) {
+            resp << "Failed. Unsupported function `" << e->name << "`." << std::endl;
+            return false;
+        }
+        if (e->distinct) {
+            resp << "Failed. DISTINCT aggregates are not supported." << std::endl;
+            return false;
+        }
+        if (!e->exprList || e->exprList->size() != 1) {
+            resp << "Failed. `" << e->name << "` takes one argument." << std::endl;
+            return false;
+        }
+
+        json a;
+        a["fn"] = fn;
+        std::string label = fn;
+        std::ranges::transform(label, label.begin(), ::toupper);
+        const auto *arg = (*e->exprList)[0];
+        if (arg->type == hsql::kExprStar && fn == "count") {
+            labels.push_back(label + "(*)");
+            out.push_back(a);
+            continue;
+        }
+        if (arg->type != hsql::kExprColumnRef) {
+            resp << "Failed. `" << e->name << "` takes a field." << std::endl;
+            return false;
+        }
+        auto it = std::ranges::find(fieldNames, arg->getName());
+        if (it == fieldNames.end()) {
+            resp << "Failed. Table does not have field `" << arg->getName() << "`." << std::endl;
+            return false;
+        }
+        int idx = static_cast<int>(std::distance(fieldNames.begin(), it));
+        int width = table->fieldTypes()[idx];
+        // every record has a value, so COUNT(field) is COUNT(*)
+        if (fn != "count") {
+            if (width == 1) {
+                resp << "Failed. Cannot aggregate BOOLEAN field `" << arg->getName() << "`." << std::endl;
+                return false;
+            }
+            a["field"] = idx;
+            a["width"] = width;
+        }
+        labels.push_back(label + "(" + arg->getName() + ")");
+        out.push_back(a);
+    }
+    return true;
+}
+
+std::vector<int> Aggregate::types(const json &aggregates) {
+    std::vector<int> ret;
+    for (const auto &a: aggregates) {
+        std::string fn = a.at("fn").get<std::string>();
+        if (fn == "min" || fn == "max") {
+            // the extreme and whether any record matched
+            ret.push_back(a.at("width").get<int>());
+            ret.push_back(1);
+        } else if (fn == "key") {
+            ret.push_back(a.at("width").get<int>());
+        } else if (fn == "avg") {
+            // sum and count
+            ret.push_back(64);
+            ret.push_back(64);
+        } else {
+            ret.push_back(64);
+        }
+    }
+    return ret;
+}
+
+static Column scalar(int type, uint64_t share) {
+    Column c(type);
+    c.append(static_cast<int64_t>(share));
+    return c;
+}
+
+static uint64_t total(const std::vector<uint64_t> &x) {
+    uint64_t ret = 0;
+    for (uint64_t v: x) {
+        ret += v;
+    }
+    return ret;
+}
+
+// additive shares of a field, sign extended
+static std::vector<uint64_t> values(const Table *table, int field) {
+    const Column &c = table->column(field);
+    std::vector<uint64_t> ret(table->size());
+    for (size_t i = 0; i < ret.size(); i++) {
+        ret[i] = c.get(i);
+    }
+    return ret;
+}
+
+// XOR share of the OR of the first `n` packed bits, log2(n) rounds
+static uint64_t any(std::vector<uint64_t> bits, size_t n, const Channel &ch) {
+    if (n == 0) {
+        return 0;
+    }
+    bits.resize(Batch::words(n));
+    if (n & 63) {
+        // padding bits may hold anything, masking each share masks the shared bits
+        bits.back() &= (1ULL << (n & 63)) - 1;
+    }
+    while (bits.size() > 1) {
+        size_t half = bits.size() / 2;
+        std::vector<uint64_t> l(bits.begin(), bits.begin() + static_cast<int64_t>(half));
+        std::vector<uint64_t> r(bits.begin() + static_cast<int64_t>(half), bits.begin() + static_cast<int64_t>(half * 2));
+        auto z = Batch::or_(l, r, ch);
+        if (bits.size() % 2 == 1) {
+            z.push_back(bits.back());
+        }
+        bits = std::move(z);
+    }
+    // fold the word onto its lowest bit
+    for (int shift = 32; shift > 0; shift >>= 1) {
+        bits = Batch::or_(bits, {bits[0] >> shift}, ch);
+    }
+    return bits[0] & 1;
+}
+
+// the smallest or largest of signed `width`-bit values: each round compares the winners of the previous one
+static uint64_t extreme(std::vector<uint64_t> x, int width, bool max, const Channel &ch) {
+    while (x.size() > 1) {
+        size_t pairs = x.size() / 2;
+        std::vector<uint64_t> a(pairs), b(pairs);
+        for (size_t k = 0; k < pairs; k++) {
+            a[k] = x[2 * k];
+            b[k] = x[2 * k + 1];
+        }
+        // b wins where it is beyond a
+        auto wins = max ? Batch::lessThan(a, b, width, ch) : Batch::lessThan(b, a, width, ch);
+        auto winners = Batch::mux(b, a, wins, ch);
+        if (x.size() % 2 == 1) {
+            winners.push_back(x.back());
+        }
+        x = std::move(winners);
+    }
+    return x.empty() ? 0 : x[0];
+}
+
+std::vector<Column> Aggregate::evaluate(const json &aggregates, const Table *table,
+                                        const std::vector<uint64_t> &matches, const Channel &ch) {
+    size_t n = table->size();
+    bool first = Comm::rank() == 0;
+    bool filtered = !matches.empty();
+
+    // match bits as additive shares, shared by COUNT, SUM and AVG
+    std::vector<uint64_t> valid;
+    bool counting = std::ranges::any_of(aggregates, [](const json &a) {
+        return a.at("fn").get<std::string>() != "min" && a.at("fn").get<std::string>() != "max";
+    });
+    if (filtered && counting) {
+        valid = Batch::toArith(matches, n, ch);
+    }
+    uint64_t count = filtered ? total(valid) : first ? n : 0;
+
+    // whether any record matched, computed once for every MIN and MAX
+    bool extremes = std::ranges::any_of(aggregates, [](const json &a) {
+        return a.at("fn").get<std::string>() == "min" || a.at("fn").get<std::string>() == "max";
+    });
+    uint64_t nonEmpty = 0;
+    if (extremes) {
+        nonEmpty = filtered ? any(matches, n, ch) : first && n > 0;
+    }
+
+    std::vector<Column> ret;
+    for (const auto &a: aggregates) {
+        std::string fn = a.at("fn").get<std::string>();
+        if (fn == "count") {
+            ret.push_back(scalar(64, count));
+            continue;
+        }
+        int width = a.at("width").get<int>();
+        auto x = values(table, a.at("field").get<int>());
+
+        if (fn == "min" || fn == "max") {
+            if (filtered) {
+                // records that do not match hold a value that never wins
+                int64_t never = fn == "min"
+                                    ? static_cast<int64_t>((1ULL << (width - 1)) - 1)
+                                    : -static_cast<int64_t>(1ULL << (width - 1));
+                std::vector<uint64_t> fill(n, first ? static_cast<uint64_t>(never) : 0);
+                x = Batch::mux(x, fill, matches, ch);
+            }
+            ret.push_back(scalar(width, extreme(std::move(x), width, fn == "max", ch)));
+            ret.push_back(scalar(1, nonEmpty));
+            continue;
+        }
+
+        // sum and avg
+        x = Batch::extend(x, width, ch);
+        if (filtered) {
+            x = Batch::mul(valid, x, ch);
+        }
+        ret.push_back(scalar(64, total(x)));
+        if (fn == "avg") {
+            ret.push_back(scalar(64, count));
+        }
+    }
+    return ret;
+}
+
+// shares of a record field, sign extended
+static std::vector<uint64_t> values(const std::vector<TempRecord> &records, int field) {
+    std::vector<uint64_t> ret(records.size());
+    for (size_t i = 0; i < ret.size(); i++) {
+        ret[i] = records[i].share(field);
+    }
+    return ret;
+}
+
+static Column column(int type, const std::vector<uint64_t> &shares) {
+    Column c(type);
+    c.reserve(shares.size());
+    for (uint64_t v: shares) {
+        c.append(static_cast<int64_t>(v));
+    }
+    return c;
+}
+
+static Column bitColumn(const std::vector<uint64_t> &bits, size_t n) {
+    Column c(1);
+    c.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        c.append(static_cast<int64_t>(Batch::bit(bits, i)));
+    }
+    return c;
+}
+
+// packed [record i + 1 has the grouping fields of record i]
+static std::vector<uint64_t> sameGroup(const std::vector<TempRecord> &records,
+                                       const std::vector<std::string> &groupFields, const Channel &ch) {
+    size_t n = records.size();
+    size_t w = Batch::words(n);
+    std::vector<uint64_t> same;
+    for (const auto &name: groupFields) {
+        int idx = records[0].getIdx(name);
+        int type = records[0].getType(idx);
+        std::vector<uint64_t> eq(w);
+        if (type == 1) {
+            for (size_t i = 0; i + 1 < n; i++) {
+                Batch::setBit(eq, i, (records[i].share(idx) ^ records[i + 1].share(idx)) & 1);
+            }
+            eq = Batch::not_(eq);
+        } else {
+            auto x = values(records, idx);
+            std::vector<uint64_t> a(x.begin(), x.end() - 1), b(x.begin() + 1, x.end());
+            auto e = Batch::equal(a, b, type, ch);
+            std::ranges::copy(e, eq.begin());
+        }
+        same = same.empty() ? eq : Batch::and_(same, eq, ch);
+    }
+    return same;
+}
+
+std::vector<Column> Aggregate::evaluateGroups(const json &aggregates, const std::vector<std::string> &groupFields,
+                                              std::vector<TempRecord> &records, int workers, const Channel &ch) {
+    size_t n = records.size();
+    if (n == 0) {
+        std::vector<Column> ret;
+        for (int t: types(aggregates)) {
+            ret.emplace_back(t);
+        }
+        ret.emplace_back(1);
+        return ret;
+    }
+    Order::sortBatched(records, groupFields, std::vector<bool>(groupFields.size(), true), workers);
+    size_t w = Batch::words(n);
+    bool first = Comm::rank() == 0;
+
+    // last[i]: record i ends its group, starts[i]: record i begins one
+    auto last = n > 1 ? Batch::not_(sameGroup(records, groupFields, ch)) : std::vector<uint64_t>(w);
+    Batch::setBit(last, n - 1, first);
+    auto starts = Batch::shift(last, n, 1);
+    Batch::setBit(starts, 0, first);
+
+    std::vector<uint64_t> valid(w);
+    for (size_t i = 0; i < n; i++) {
+        Batch::setBit(valid, i, records[i]._valid.get());
+    }
+
+    // additive lanes, lane 0 counts the matching records of each group
+    std::vector<std::vector<uint64_t> > sums = {Batch::toArith(valid, n, ch)};
+    std::map<size_t, size_t> laneOf;
+    std::vector<uint64_t> conds, lifted;
+    for (size_t k = 0; k < aggregates.size(); k++) {
+        std::string fn = aggregates[k].at("fn").get<std::string>();
+        if (fn == "sum" || fn == "avg") {
+            auto x = Batch::extend(values(records, aggregates[k].at("field").get<int>()),
+                                   aggregates[k].at("width").get<int>(), ch);
+            lifted.insert(lifted.end(), x.begin(), x.end());
+            conds.insert(conds.end(), sums[0].begin(), sums[0].end());
+            size_t lane = laneOf.size() + 1;
+            laneOf[k] = lane;
+        }
+    }
+    if (!lifted.empty()) {
+        // records that do not match add nothing
+        auto t = Batch::mul(conds, lifted, ch);
+        for (size_t l = 0; l * n < t.size(); l++) {
+            sums.emplace_back(t.begin() + static_cast<int64_t>(l * n), t.begin() + static_cast<int64_t>((l + 1) * n));
+        }
+    }
+
+    // MIN and MAX lanes, records that do not match hold a value that never wins
+    std::map<size_t, std::vector<uint64_t> > extremes;
+    for (size_t k = 0; k < aggregates.size(); k++) {
+        std::string fn = aggregates[k].at("fn").get<std::string>();
+        if (fn == "min" || fn == "max") {
+            int width = aggregates[k].at("width").get<int>();
+            int64_t never = fn == "min"
+                                ? static_cast<int64_t>((1ULL << (width - 1)) - 1)
+                                : -static_cast<int64_t>(1ULL << (width - 1));
+            std::vector<uint64_t> fill(n, first ? static_cast<uint64_t>(never) : 0);
+            extremes[k] = Batch::mux(values(records, aggregates[k].at("field").get<int>()), fill, valid, ch);
+        }
+    }
+
+    // Segmented scan: after the level of distance d, record i holds the aggregate of its group over the last 2d
+    // records, and `f` whether its group begins among them. A record takes in record i - d while it does not.
+    auto f = starts;
+    for (size_t d = 1; d < n; d <<= 1) {
+        auto open = Batch::not_(f);
+
+        auto keep = Batch::toArith(open, n, ch);
+        std::vector<uint64_t> keeps, prev;
+        for (const auto &lane: sums) {
+            keeps.insert(keeps.end(), keep.begin(), keep.end());
+            prev.insert(prev.end(), d, 0);
+            prev.insert(prev.end(), lane.begin(), lane.end() - static_cast<int64_t>(d));
+        }
+        auto t = Batch::mul(keeps, prev, ch);
+        for (size_t l = 0; l < sums.size(); l++) {
+            for (size_t i = 0; i < n; i++) {
+                sums[l][i] += t[l * n + i];
+            }
+        }
+
+        for (auto &[k, v]: extremes) {
+            // the first d records compare with themselves and keep their value
+            std::vector<uint64_t> before(v.begin(), v.begin() + static_cast<int64_t>(d));
+            before.insert(before.end(), v.begin(), v.end() - static_cast<int64_t>(d));
+            int width = aggregates[k].at("width").get<int>();
+            auto wins = aggregates[k].at("fn").get<std::string>() == "max"
+                            ? Batch::lessThan(v, before, width, ch)
+                            : Batch::lessThan(before, v, width, ch);
+            v = Batch::mux(before, v, Batch::and_(open, wins, ch), ch);
+        }
+
+        if (d * 2 < n) {
+            f = Batch::or_(f, Batch::shift(f, n, d), ch);
+        }
+    }
+
+    // a record outputs its group when it ends the group and the group has a matching record
+    auto nonEmpty = Batch::lessThan(std::vector<uint64_t>(n), sums[0], 64, ch);
+    auto output = Batch::and_(last, nonEmpty, ch);
+
+    // output columns laid out as types(), an empty lane stands for the output bits
+    std::vector<int> outTypes = types(aggregates);
+    std::vector<std::vector<uint64_t> > lanes;
+    for (size_t k = 0; k < aggregates.size(); k++) {
+        const auto &a = aggregates[k];
+        std::string fn = a.at("fn").get<std::string>();
+        if (fn == "key") {
+            lanes.push_back(values(records, a.at("field").get<int>()));
+        } else if (fn == "count") {
+            lanes.push_back(sums[0]);
+        } else if (fn == "min" || fn == "max") {
+            lanes.push_back(extremes[k]);
+            lanes.emplace_back();
+        } else {
+            lanes.push_back(sums[laneOf[k]]);
+            if (fn == "avg") {
+                lanes.push_back(sums[0]);
+            }
+        }
+    }
+
+    // Records that output no group hold zeros instead of the keys and running aggregates of their group, which
+    // would tell group sizes and partial sums when they are revealed along with the groups
+    auto keep = Batch::toArith(output, n, ch);
+    std::vector<uint64_t> keeps, ints, outputs, bits;
+    for (size_t l = 0; l < lanes.size(); l++) {
+        if (lanes[l].empty()) {
+            continue;
+        }
+        if (outTypes[l] == 1) {
+            std::vector<uint64_t> packed(w);
+            for (size_t i = 0; i < n; i++) {
+                Batch::setBit(packed, i, lanes[l][i] & 1);
+            }
+            outputs.insert(outputs.end(), output.begin(), output.end());
+            bits.insert(bits.end(), packed.begin(), packed.end());
+        } else {
+            keeps.insert(keeps.end(), keep.begin(), keep.end());
+            ints.insert(ints.end(), lanes[l].begin(), lanes[l].end());
+        }
+    }
+    auto kept = ints.empty() ? ints : Batch::mul(keeps, ints, ch);
+    // BOOLEAN keys only
+    auto keptBits = bits.empty() ? bits : Batch::and_(outputs, bits, ch);
+
+    std::vector<Column> ret;
+    size_t intLane = 0, bitLane = 0;
+    for (size_t l = 0; l < lanes.size(); l++) {
+        if (lanes[l].empty()) {
+            ret.push_back(bitColumn(output, n));
+        } else if (outTypes[l] == 1) {
+            ret.push_back(bitColumn({keptBits.begin() + static_cast<int64_t>(bitLane * w),
+                                     keptBits.begin() + static_cast<int64_t>((bitLane + 1) * w)}, n));
+            bitLane++;
+        } else {
+            ret.push_back(column(outTypes[l], {kept.begin() + static_cast<int64_t>(intLane * n),
+                                               kept.begin() + static_cast<int64_t>((intLane + 1) * n)}));
+            intLane++;
+        }
+    }
+    ret.push_back(bitColumn(output, n));
+    return ret;
+}
+
+std::vector<std::string> Aggregate::format(const json &aggregates, const std::vector<std::vector<int64_t> > &values,
+                                           size_t row) {
+    std::vector<std::string> ret;
+    size_t c = 0;
+    for (const auto &a: aggregates) {
+        std::string fn = a.at("fn").get<std::string>();
+        if (fn == "min" || fn == "max") {
+            ret.push_back(values[c + 1][row] ? std::to_string(values[c][row]) : "NULL");
+            c += 2;
+        } else if (fn == "avg") {
+            int64_t count = values[c + 1][row];
+            std::ostringstream avg;
+            avg << static_cast<double>(values[c][row]) / static_cast<double>(count);
+            ret.push_back(count ? avg.str() : "NULL");
+            c += 2;
+        } else {
+            ret.push_back(std::to_string(values[c][row]));
+            c++;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,118 @@
+#include "function/Compact.h"
+#include <algorithm>
+#include <bit>
+#include <mpc_package/utils/Comm.h>
+
+#include "secret/Batch.h"
+
+// The number of rows to keep out of `n`: the opened `count`, or when `padded` the smallest power of two not below
+// it, opened as the bits [2^k < count]
+static size_t keep(uint64_t count, size_t n, bool padded, const Channel &ch) {
+    bool first = Comm::rank() == 0;
+    if (n == 0) {
+        return 0;
+    }
+    if (!padded) {
+        return count + ch.exchange(std::vector<uint64_t>{count})[0];
+    }
+    size_t levels = std::bit_width(n);
+    std::vector<uint64_t> powers(levels), counts(levels, count);
+    for (size_t k = 0; k < levels; k++) {
+        powers[k] = first ? 1ULL << k : 0;
+    }
+    auto below = Batch::lessThan(powers, counts, 64, ch);
+    auto other = ch.exchange(below);
+    size_t exponent = 0;
+    for (size_t k = 0; k < levels; k++) {
+        exponent += Batch::bit(below, k) ^ Batch::bit(other, k);
+    }
+    return std::min(n, size_t{1} << exponent);
+}
+
+std::vector<Column> Compact::evaluate(const std::vector<const Column *> &columns, bool padded, int64_t limit,
+                                     const Channel &ch) {
+    size_t n = columns.back()->size();
+    bool first = Comm::rank() == 0;
+
+    // rank among the valid rows before each row, and their count
+    std::vector<uint64_t> valid(Batch::words(n));
+    for (size_t i = 0; i < n; i++) {
+        Batch::setBit(valid, i, columns.back()->get(i) & 1);
+    }
+    auto a = Batch::toArith(valid, n, ch);
+    std::vector<uint64_t> rank(n);
+    uint64_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        rank[i] = count;
+        count += a[i];
+    }
+
+    size_t rows = keep(count, n, padded, ch);
+    if (limit >= 0) {
+        rows = std::min(rows, static_cast<size_t>(limit));
+    }
+    std::vector<Column> ret;
+    for (const auto *c: columns) {
+        ret.emplace_back(c->type());
+        ret.back().reserve(rows);
+    }
+    if (rows == n) {
+        for (size_t c = 0; c < columns.size(); c++) {
+            ret[c].append(*columns[c]);
+        }
+        return ret;
+    }
+
+    // valid rows go to their rank, the i-th row goes to count + i - rank otherwise:
+    // place = (count + i - rank) + a * (2 * rank - count - i)
+    std::vector<uint64_t> others(n), diffs(n);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t position = first ? i : 0;
+        others[i] = count + position - rank[i];
+        diffs[i] = 2 * rank[i] - count - position;
+    }
+    auto t = Batch::mul(a, diffs, ch);
+
+    // additive words: the place and the integer columns, then the bit columns packed into XOR words
+    std::vector<size_t> intColumns, bitColumns;
+    for (size_t c = 0; c < columns.size(); c++) {
+        (columns[c]->type() == 1 ? bitColumns : intColumns).push_back(c);
+    }
+    size_t ints = intColumns.size() + 1;
+    size_t width = ints + Batch::words(bitColumns.size());
+    std::vector<uint64_t> table(n * width);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t *row = table.data() + i * width;
+        row[0] = others[i] + t[i];
+        for (size_t k = 0; k < intColumns.size(); k++) {
+            row[k + 1] = columns[intColumns[k]]->get(i);
+        }
+        for (size_t k = 0; k < bitColumns.size(); k++) {
+            row[ints + (k >> 6)] |= (columns[bitColumns[k]]->get(i) & 1) << (k & 63);
+        }
+    }
+    Batch::shuffle(table, width, ints, ch);
+
+    std::vector<uint64_t> places(n);
+    for (size_t i = 0; i < n; i++) {
+        places[i] = table[i * width];
+    }
+    auto other = ch.exchange(places);
+    std::vector<size_t> sources(rows);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t place = places[i] + other[i];
+        if (place < rows) {
+            sources[place] = i;
+        }
+    }
+    for (size_t s: sources) {
+        const uint64_t *row = table.data() + s * width;
+        for (size_t k = 0; k < intColumns.size(); k++) {
+            ret[intColumns[k]].append(static_cast<int64_t>(row[k + 1]));
+        }
+        for (size_t k = 0; k < bitColumns.size(); k++) {
+            ret[bitColumns[k]].append(static_cast<int64_t>((row[ints + (k >> 6)] >> (k & 63)) & 1));
+        }
+    }
+    return ret;
+}
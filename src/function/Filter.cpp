@@ -0,0 +1,222 @@
+#include "function/Filter.h"
+
+#include <mpc_package/utils/Comm.h>
+
+#include "secret/Batch.h"
+
+using json = nlohmann::json;
+
+// encoded operand: {"field": idx} or {"value": v}, `type` is the field type or 0 for a constant
+static bool encodeOperand(std::ostringstream &resp, const hsql::Expr *expr, const Table *table, json &out,
+                          int &type) {
+    const auto &fieldNames = table->fieldNames();
+    if (expr->type == hsql::kExprColumnRef) {
+        auto it = std::ranges::find(fieldNames, expr->getName());
+        if (it == fieldNames.end()) {
+            resp << "Failed. Table does not have field `" << expr->getName() << "`." << std::endl;
+            return false;
+        }
+        int idx = static_cast<int>(std::distance(fieldNames.begin(), it));
+        out["field"] = idx;
+        type = table->fieldTypes()[idx];
+        return true;
+    }
+    if (expr->type == hsql::kExprLiteralInt) {
+        out["value"] = expr->ival;
+        type = 0;
+        return true;
+    }
+    if (expr->type == hsql::kExprOperator && expr->opType == hsql::kOpUnaryMinus
+        && expr->expr->type == hsql::kExprLiteralInt) {
+        out["value"] = -expr->expr->ival;
+        type = 0;
+        return true;
+    }
+    resp << "Failed. Unsupported operand in WHERE clause." << std::endl;
+    return false;
+}
+
+// `lt` or `eq` of two operands, of which at least one is a field
+static bool encodeComparison(std::ostringstream &resp, const char *op, const hsql::Expr *l, const hsql::Expr *r,
+                             const Table *table, json &out) {
+    json args[2];
+    int types[2];
+    if (!encodeOperand(resp, l, table, args[0], types[0]) || !encodeOperand(resp, r, table, args[1], types[1])) {
+        return false;
+    }
+    int width = std::max(types[0], types[1]);
+    if (width == 0) {
+        resp << "Failed. WHERE compares two constants." << std::endl;
+        return false;
+    }
+    if (types[0] && types[1] && types[0] != types[1]) {
+        resp << "Failed. WHERE compares fields of different types." << std::endl;
+        return false;
+    }
+    if (width == 1 && std::string(op) != "eq") {
+        resp << "Failed. BOOLEAN fields only support `=` and `!=`." << std::endl;
+        return false;
+    }
+    for (const auto &a: args) {
+        if (a.contains("value") && !Column::fits(a.at("value").get<int64_t>(), width)) {
+            resp << "Failed. Value " << a.at("value").get<int64_t>() << " is out of range in WHERE clause."
+                    << std::endl;
+            return false;
+        }
+    }
+    out["op"] = op;
+    out["width"] = width;
+    out["args"] = {args[0], args[1]};
+    return true;
+}
+
+static json negate(json j) {
+    json ret;
+    ret["op"] = "not";
+    ret["args"] = {std::move(j)};
+    return ret;
+}
+
+bool Filter::encode(std::ostringstream &resp, const hsql::Expr *where, const Table *table, json &out) {
+    if (where->type == hsql::kExprColumnRef) {
+        int type;
+        if (!encodeOperand(resp, where, table, out, type)) {
+            return false;
+        }
+        if (type != 1) {
+            resp << "Failed. Field `" << where->getName() << "` is not BOOLEAN." << std::endl;
+            return false;
+        }
+        out["op"] = "field";
+        return true;
+    }
+    if (where->type == hsql::kExprLiteralInt) {
+        out["op"] = "const";
+        out["value"] = static_cast<int64_t>(where->ival != 0);
+        return true;
+    }
+    if (where->type != hsql::kExprOperator) {
+        resp << "Failed. Unsupported WHERE clause." << std::endl;
+        return false;
+    }
+
+    // servers only evaluate lt, eq, not, and, or
+    const hsql::Expr *l = where->expr, *r = where->expr2;
+    json sub;
+    switch (where->opType) {
+        case hsql::kOpAnd:
+        case hsql::kOpOr: {
+            json args[2];
+            if (!encode(resp, l, table, args[0]) || !encode(resp, r, table, args[1])) {
+                return false;
+            }
+            out["op"] = where->opType == hsql::kOpAnd ? "and" : "or";
+            out["args"] = {args[0], args[1]};
+            return true;
+        }
+        case hsql::kOpNot:
+            if (!encode(resp, l, table, sub)) {
+                return false;
+            }
+            out = negate(sub);
+            return true;
+        case hsql::kOpEquals:
+            return encodeComparison(resp, "eq", l, r, table, out);
+        case hsql::kOpNotEquals:
+            if (!encodeComparison(resp, "eq", l, r, table, sub)) {
+                return false;
+            }
+            out = negate(sub);
+            return true;
+        case hsql::kOpLess:
+            return encodeComparison(resp, "lt", l, r, table, out);
+        case hsql::kOpGreater:
+            return encodeComparison(resp, "lt", r, l, table, out);
+        case hsql::kOpLessEq:
+            if (!encodeComparison(resp, "lt", r, l, table, sub)) {
+                return false;
+            }
+            out = negate(sub);
+            return true;
+        case hsql::kOpGreaterEq:
+            if (!encodeComparison(resp, "lt", l, r, table, sub)) {
+                return false;
+            }
+            out = negate(sub);
+            return true;
+        case hsql::kOpBetween: {
+            // lo <= x and x <= hi
+            json lower, upper;
+            if (!where->exprList || where->exprList->size() != 2
+                || !encodeComparison(resp, "lt", l, (*where->exprList)[0], table, lower)
+                || !encodeComparison(resp, "lt", (*where->exprList)[1], l, table, upper)) {
+                return false;
+            }
+            out["op"] = "and";
+            out["args"] = {negate(lower), negate(upper)};
+            return true;
+        }
+        default:
+            resp << "Failed. Unsupported operator in WHERE clause." << std::endl;
+            return false;
+    }
+}
+
+// additive shares of an operand, sign extended
+static std::vector<uint64_t> arithOperand(const json &j, const Table *table) {
+    size_t n = table->size();
+    if (j.contains("value")) {
+        uint64_t v = Comm::rank() == 0 ? j.at("value").get<int64_t>() : 0;
+        return std::vector<uint64_t>(n, v);
+    }
+    const Column &c = table->column(j.at("field").get<int>());
+    std::vector<uint64_t> ret(n);
+    for (size_t i = 0; i < n; i++) {
+        ret[i] = c.get(i);
+    }
+    return ret;
+}
+
+// packed XOR shares of a BOOLEAN operand
+static std::vector<uint64_t> bitOperand(const json &j, const Table *table) {
+    size_t w = Batch::words(table->size());
+    if (j.contains("value")) {
+        uint64_t v = Comm::rank() == 0 && j.at("value").get<int64_t>() ? ~0ULL : 0;
+        return std::vector<uint64_t>(w, v);
+    }
+    const uint64_t *words = table->bitColumnView(j.at("field").get<int>()).words();
+    return {words, words + w};
+}
+
+std::vector<uint64_t> Filter::evaluate(const json &where, const Table *table, const Channel &ch) {
+    std::string op = where.at("op").get<std::string>();
+    if (op == "const") {
+        return bitOperand(where, table);
+    }
+    if (op == "field") {
+        return bitOperand(where, table);
+    }
+    if (op == "not") {
+        return Batch::not_(evaluate(where.at("args")[0], table, ch));
+    }
+    if (op == "and" || op == "or") {
+        auto l = evaluate(where.at("args")[0], table, ch);
+        auto r = evaluate(where.at("args")[1], table, ch);
+        return op == "and" ? Batch::and_(l, r, ch) : Batch::or_(l, r, ch);
+    }
+
+    const json &args = where.at("args");
+    int width = where.at("width").get<int>();
+    if (width == 1) {
+        // BOOLEAN equality is local: [x == y] = ![x ^ y]
+        auto x = bitOperand(args[0], table);
+        auto y = bitOperand(args[1], table);
+        for (size_t i = 0; i < x.size(); i++) {
+            x[i] ^= y[i];
+        }
+        return Batch::not_(x);
+    }
+    auto x = arithOperand(args[0], table);
+    auto y = arithOperand(args[1], table);
+    return op == "lt" ? Batch::lessThan(x, y, width, ch) : Batch::equal(x, y, width, ch);
+}
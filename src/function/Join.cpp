@@ -0,0 +1,388 @@
+#include "function/Join.h"
+
+#include <cstring>
+#include <mpc_package/utils/Comm.h>
+
+#include "function/Aggregate.h"
+#include "function/Filter.h"
+#include "function/Order.h"
+#include "secret/Batch.h"
+
+using json = nlohmann::json;
+
+// side of column `e`, 0 for the left table and 1 for the right one, and its index in that table
+static bool resolve(std::ostringstream &resp, const hsql::Expr *e, const hsql::TableRef *const refs[2],
+                    const Table *const tables[2], int &side, int &idx) {
+    side = -1;
+    for (int s = 0; s < 2; s++) {
+        if (e->table && strcmp(e->table, refs[s]->getName()) != 0) {
+            continue;
+        }
+        const auto &fieldNames = tables[s]->fieldNames();
+        auto it = std::ranges::find(fieldNames, e->getName());
+        if (it == fieldNames.end()) {
+            continue;
+        }
+        if (side >= 0) {
+            resp << "Failed. Field `" << e->getName() << "` is ambiguous." << std::endl;
+            return false;
+        }
+        side = s;
+        idx = static_cast<int>(std::distance(fieldNames.begin(), it));
+    }
+    if (side < 0) {
+        resp << "Failed. No joined table has field `" << (e->table ? std::string(e->table) + "." : "")
+                << e->getName() << "`." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static void columnRefs(const hsql::Expr *e, std::vector<const hsql::Expr *> &out) {
+    if (!e) {
+        return;
+    }
+    if (e->type == hsql::kExprColumnRef) {
+        out.push_back(e);
+        return;
+    }
+    columnRefs(e->expr, out);
+    columnRefs(e->expr2, out);
+    if (e->exprList) {
+        for (const auto *x: *e->exprList) {
+            columnRefs(x, out);
+        }
+    }
+}
+
+bool Join::encode(std::ostringstream &resp, const hsql::SelectStatement *selectStmt, Database *database, json &out,
+                  std::vector<std::string> &labels, std::vector<int> &types) {
+    const auto *join = selectStmt->fromTable->join;
+    if (join->type != hsql::kJoinInner) {
+        resp << "Failed. Only inner joins are supported." << std::endl;
+        return false;
+    }
+    const hsql::TableRef *refs[2] = {join->left, join->right};
+    const Table *tables[2];
+    for (int s = 0; s < 2; s++) {
+        if (refs[s]->type != hsql::kTableName) {
+            resp << "Failed. Only tables can be joined." << std::endl;
+            return false;
+        }
+        tables[s] = database->getTable(refs[s]->name);
+        if (!tables[s]) {
+            resp << "Failed. Table `" << refs[s]->name << "` does not exist." << std::endl;
+            return false;
+        }
+    }
+    if (strcmp(refs[0]->getName(), refs[1]->getName()) == 0) {
+        resp << "Failed. Joined tables need distinct names or aliases." << std::endl;
+        return false;
+    }
+    if (selectStmt->groupBy || selectStmt->order || Aggregate::contains(selectStmt->selectList)) {
+        resp << "Failed. GROUP BY, ORDER BY and aggregates are not supported with JOIN." << std::endl;
+        return false;
+    }
+
+    // on
+    const auto *on = join->condition;
+    if (!on || on->type != hsql::kExprOperator || on->opType != hsql::kOpEquals
+        || on->expr->type != hsql::kExprColumnRef || on->expr2->type != hsql::kExprColumnRef) {
+        resp << "Failed. JOIN takes ON with an equality of two fields, the second table holding each key once."
+                << std::endl;
+        return false;
+    }
+    int sides[2], keys[2];
+    if (!resolve(resp, on->expr, refs, tables, sides[0], keys[0])
+        || !resolve(resp, on->expr2, refs, tables, sides[1], keys[1])) {
+        return false;
+    }
+    if (sides[0] == sides[1]) {
+        resp << "Failed. ON compares fields of the same table." << std::endl;
+        return false;
+    }
+    if (sides[0] == 1) {
+        std::swap(keys[0], keys[1]);
+    }
+    if (tables[0]->fieldTypes()[keys[0]] != tables[1]->fieldTypes()[keys[1]]) {
+        resp << "Failed. ON compares fields of different types." << std::endl;
+        return false;
+    }
+
+    // select content
+    json columns = json::array();
+    for (const auto *e: *selectStmt->selectList) {
+        if (e->type == hsql::kExprStar) {
+            for (int s = 0; s < 2; s++) {
+                for (int idx = 0; idx < tables[s]->fieldNames().size(); idx++) {
+                    columns.push_back({s, idx});
+                    labels.push_back(tables[s]->fieldNames()[idx]);
+                    types.push_back(tables[s]->fieldTypes()[idx]);
+                }
+            }
+            continue;
+        }
+        if (e->type != hsql::kExprColumnRef) {
+            resp << "Failed. Unsupported select list with JOIN." << std::endl;
+            return false;
+        }
+        int side, idx;
+        if (!resolve(resp, e, refs, tables, side, idx)) {
+            return false;
+        }
+        columns.push_back({side, idx});
+        labels.push_back(e->table ? std::string(e->table) + "." + e->getName() : e->getName());
+        types.push_back(tables[side]->fieldTypes()[idx]);
+    }
+
+    // where, on the fields of a single table
+    if (selectStmt->whereClause) {
+        std::vector<const hsql::Expr *> refsInWhere;
+        columnRefs(selectStmt->whereClause, refsInWhere);
+        int whereSide = 0;
+        for (size_t i = 0; i < refsInWhere.size(); i++) {
+            int side, idx;
+            if (!resolve(resp, refsInWhere[i], refs, tables, side, idx)) {
+                return false;
+            }
+            if (i > 0 && side != whereSide) {
+                resp << "Failed. WHERE may only filter the fields of one table with JOIN." << std::endl;
+                return false;
+            }
+            whereSide = side;
+        }
+        json where;
+        if (!Filter::encode(resp, selectStmt->whereClause, tables[whereSide], where)) {
+            return false;
+        }
+        out["where"] = where;
+        out["whereSide"] = whereSide;
+    }
+
+    out["left"] = tables[0]->name();
+    out["right"] = tables[1]->name();
+    out["keys"] = {keys[0], keys[1]};
+    out["columns"] = columns;
+    return true;
+}
+
+// a secret of `type` holding `share`
+static FieldValue secret(int type, int64_t share) {
+    switch (type) {
+        case 1:
+            return BitSecret(share & 1);
+        case 8:
+            return IntSecret<int8_t>(static_cast<int8_t>(share));
+        case 16:
+            return IntSecret<int16_t>(static_cast<int16_t>(share));
+        case 32:
+            return IntSecret<int32_t>(static_cast<int32_t>(share));
+        default:
+            return IntSecret<int64_t>(share);
+    }
+}
+
+// shares of a record field, sign extended
+static std::vector<uint64_t> values(const std::vector<TempRecord> &records, int field) {
+    std::vector<uint64_t> ret(records.size());
+    for (size_t i = 0; i < ret.size(); i++) {
+        ret[i] = records[i].share(field);
+    }
+    return ret;
+}
+
+static std::vector<uint64_t> bits(const std::vector<TempRecord> &records, int field) {
+    std::vector<uint64_t> ret(Batch::words(records.size()));
+    for (size_t i = 0; i < records.size(); i++) {
+        Batch::setBit(ret, i, field < 0 ? records[i]._valid.get() : records[i].share(field) & 1);
+    }
+    return ret;
+}
+
+static Column column(int type, const std::vector<uint64_t> &shares) {
+    Column c(type);
+    c.reserve(shares.size());
+    for (uint64_t v: shares) {
+        c.append(static_cast<int64_t>(v));
+    }
+    return c;
+}
+
+static Column bitColumn(const std::vector<uint64_t> &bits, size_t n) {
+    Column c(1);
+    c.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        c.append(static_cast<int64_t>(Batch::bit(bits, i)));
+    }
+    return c;
+}
+
+std::vector<Column> Join::evaluate(const json &join, const Table *left, const Table *right,
+                                   const std::vector<uint64_t> &leftMatches,
+                                   const std::vector<uint64_t> &rightMatches, int workers, const Channel &ch) {
+    const Table *tables[2] = {left, right};
+    const std::vector<uint64_t> *matches[2] = {&leftMatches, &rightMatches};
+    auto keys = join.at("keys").get<std::vector<int> >();
+    int keyType = left->fieldTypes()[keys[0]];
+
+    // fields each table brings along, in the order they are selected
+    std::vector<int> fields[2];
+    for (const auto &c: join.at("columns")) {
+        int side = c[0].get<int>();
+        int idx = c[1].get<int>();
+        if (std::ranges::find(fields[side], idx) == fields[side].end()) {
+            fields[side].push_back(idx);
+        }
+    }
+    // record layout: key, tag, the fields of the left table, then those of the right one
+    std::vector<std::string> names = {"key", "tag"};
+    std::vector<int> types = {keyType, 1};
+    int offsets[2] = {2, 2 + static_cast<int>(fields[0].size())};
+    for (int s = 0; s < 2; s++) {
+        for (int idx: fields[s]) {
+            names.push_back(tables[s]->name() + "." + tables[s]->fieldNames()[idx]);
+            types.push_back(tables[s]->fieldTypes()[idx]);
+        }
+    }
+
+    size_t n = left->size() + right->size();
+    if (left->size() == 0 || right->size() == 0) {
+        // nothing matches, compaction and reveal pass on the empty columns
+        std::vector<Column> ret;
+        for (const auto &c: join.at("columns")) {
+            ret.emplace_back(tables[c[0].get<int>()]->fieldTypes()[c[1].get<int>()]);
+        }
+        ret.emplace_back(1);
+        return ret;
+    }
+
+    // concatenate both tables, the tag is set on left records so that they sort after the right ones of their key
+    bool first = Comm::rank() == 0;
+    auto schema = std::make_shared<const Schema>(std::move(names), types);
+    std::vector<TempRecord> records(n);
+    for (size_t i = 0; i < n; i++) {
+        int s = i >= left->size();
+        size_t row = s ? i - left->size() : i;
+        auto &r = records[i];
+        r._schema = schema;
+        r._fieldValues.reserve(types.size());
+        r._fieldValues.push_back(tables[s]->column(keys[s]).secret(row));
+        r._fieldValues.emplace_back(BitSecret(s == 0 && first));
+        for (int side = 0; side < 2; side++) {
+            for (int idx: fields[side]) {
+                r._fieldValues.push_back(side == s
+                                             ? tables[s]->column(idx).secret(row)
+                                             : secret(tables[side]->fieldTypes()[idx], 0));
+            }
+        }
+        if (!matches[s]->empty()) {
+            r._valid = BitSecret(Batch::bit(*matches[s], row));
+        }
+    }
+    Order::sortBatched(records, {"key", "tag"}, {true, true}, workers);
+
+    // lanes carried down from right records: their fields, the key and the valid bit (-1)
+    std::vector<int> intFields, bitFields;
+    (keyType == 1 ? bitFields : intFields).push_back(0);
+    for (size_t k = 0; k < fields[1].size(); k++) {
+        int idx = offsets[1] + static_cast<int>(k);
+        (types[idx] == 1 ? bitFields : intFields).push_back(idx);
+    }
+    bitFields.push_back(-1);
+    std::vector<std::vector<uint64_t> > ints, packed;
+    for (int idx: intFields) {
+        ints.push_back(values(records, idx));
+    }
+    for (int idx: bitFields) {
+        packed.push_back(bits(records, idx));
+    }
+
+    // After the level of distance d, `has` tells whether one of the last 2d records is a right record, and the
+    // lanes hold the nearest of them. A record without one takes the lanes of record i - d.
+    auto tags = bits(records, 1);
+    auto has = Batch::not_(tags);
+    size_t w = Batch::words(n);
+    for (size_t d = 1; d < n; d <<= 1) {
+        auto take = Batch::not_(has);
+
+        // integers: v += take * (v[i - d] - v), the first d records keep their lanes
+        auto arithTake = Batch::toArith(take, n, ch);
+        std::vector<uint64_t> takes, diffs;
+        for (const auto &v: ints) {
+            takes.insert(takes.end(), arithTake.begin(), arithTake.end());
+            diffs.insert(diffs.end(), d, 0);
+            for (size_t i = d; i < n; i++) {
+                diffs.push_back(v[i - d] - v[i]);
+            }
+        }
+        auto t = Batch::mul(takes, diffs, ch);
+        for (size_t l = 0; l < ints.size(); l++) {
+            for (size_t i = 0; i < n; i++) {
+                ints[l][i] += t[l * n + i];
+            }
+        }
+
+        // bits: v ^= take & (v[i - d] ^ v)
+        takes.clear();
+        diffs.clear();
+        for (const auto &v: packed) {
+            takes.insert(takes.end(), take.begin(), take.end());
+            auto diff = Batch::shift(v, n, d);
+            for (size_t k = 0; k < w; k++) {
+                diff[k] ^= v[k];
+            }
+            for (size_t i = 0; i < d; i++) {
+                Batch::setBit(diff, i, false);
+            }
+            diffs.insert(diffs.end(), diff.begin(), diff.end());
+        }
+        t = Batch::and_(takes, diffs, ch);
+        for (size_t l = 0; l < packed.size(); l++) {
+            for (size_t k = 0; k < w; k++) {
+                packed[l][k] ^= t[l * w + k];
+            }
+        }
+
+        has = Batch::or_(has, Batch::shift(has, n, d), ch);
+    }
+
+    // the key of the record equals the key carried down to it
+    std::vector<uint64_t> eq;
+    if (keyType == 1) {
+        auto own = bits(records, 0);
+        eq.resize(w);
+        for (size_t k = 0; k < w; k++) {
+            eq[k] = own[k] ^ packed[0][k];
+        }
+        eq = Batch::not_(eq);
+    } else {
+        eq = Batch::equal(values(records, 0), ints[0], keyType, ch);
+    }
+
+    // a left record outputs when it and the right record it met pass WHERE and share the key
+    auto valid = bits(records, -1);
+    std::vector<uint64_t> lhs = tags, rhs = valid;
+    lhs.insert(lhs.end(), has.begin(), has.end());
+    rhs.insert(rhs.end(), packed.back().begin(), packed.back().end());
+    auto both = Batch::and_(lhs, rhs, ch);
+    auto output = Batch::and_(std::vector<uint64_t>(both.begin(), both.begin() + static_cast<int64_t>(w)),
+                              std::vector<uint64_t>(both.begin() + static_cast<int64_t>(w), both.end()), ch);
+    output = Batch::and_(output, eq, ch);
+
+    std::vector<Column> ret;
+    for (const auto &c: join.at("columns")) {
+        int side = c[0].get<int>();
+        int idx = offsets[side] + static_cast<int>(std::distance(
+                      fields[side].begin(), std::ranges::find(fields[side], c[1].get<int>())));
+        int type = types[idx];
+        if (side == 0) {
+            ret.push_back(type == 1 ? bitColumn(bits(records, idx), n) : column(type, values(records, idx)));
+        } else if (type == 1) {
+            ret.push_back(bitColumn(packed[std::distance(bitFields.begin(), std::ranges::find(bitFields, idx))], n));
+        } else {
+            ret.push_back(column(type, ints[std::distance(intFields.begin(), std::ranges::find(intFields, idx))]));
+        }
+    }
+    ret.push_back(bitColumn(output, n));
+    return ret;
+}
@@ -3,9 +3,16 @@
 //
 
 #include "function/Order.h"
-#include <cmath>
+#include <algorithm>
+#include <bit>
 #include <mpc_package/utils/Log.h>
 
+#include "secret/Batch.h"
+#include "secret/WorkerPool.h"
+
+// fewer comparators are not worth a worker of their own
+static constexpr size_t MIN_SLICE = 64;
+
 template<typename T>
 void muxSwapHelper(TempRecord &first, TempRecord &second, int fieldIndex, BitSecret swap) {
     auto s0 = std::get<IntSecret<T> >(first._fieldValues[fieldIndex]);
@@ -73,51 +80,606 @@ BitSecret Order::requiresSwap(const TempRecord &r0, const TempRecord &r1,
 
 void Order::bitonicSort(std::vector<TempRecord> &records, const std::vector<std::string> &fieldNames,
                              const std::vector<BitSecret> &ascendingOrders) {
-    size_t N = records.size();
-    auto is_power_of_two = [](size_t n) {
-        return n && (!(n & (n - 1)));
-    };
+    if (records.size() < 2) {
+        return;
+    }
+    // every comparator moves the record that comes first to its first position
+    auto schedule = SortingNetwork::of(records.size(), SortingNetwork::BITONIC);
+    std::vector<std::pair<size_t, size_t> > comparators;
+    for (size_t s = 0; s < schedule->stages(); s++) {
+        schedule->stage(s, comparators);
+        for (auto [i, j]: comparators) {
+            BitSecret swap = requiresSwap(records[i], records[j], fieldNames, ascendingOrders);
+            muxSwap(records[i], records[j], swap);
+        }
+    }
+}
+// Packed shares of field `idx` (bits) or additive shares (integers) of the pairs' first or second records,
+// each half aligned to whole words
+static void gatherField(const std::vector<TempRecord> &records, const std::vector<std::pair<size_t, size_t> > &pairs,
+                        int idx, bool bits, std::vector<uint64_t> &first, std::vector<uint64_t> &second) {
+    size_t n = pairs.size();
+    first.assign(bits ? Batch::words(n) : n, 0);
+    second.assign(bits ? Batch::words(n) : n, 0);
+    for (size_t k = 0; k < n; k++) {
+        uint64_t s0 = idx < 0 ? records[pairs[k].first]._valid.get() : records[pairs[k].first].share(idx);
+        uint64_t s1 = idx < 0 ? records[pairs[k].second]._valid.get() : records[pairs[k].second].share(idx);
+        if (bits) {
+            Batch::setBit(first, k, s0 & 1);
+            Batch::setBit(second, k, s1 & 1);
+        } else {
+            first[k] = s0;
+            second[k] = s1;
+        }
+    }
+}
+
+std::vector<uint64_t> Order::requiresSwapBatched(const std::vector<TempRecord> &records,
+                                                 const std::vector<std::pair<size_t, size_t> > &pairs,
+                                                 const std::vector<std::string> &orderFields,
+                                                 const std::vector<bool> &ascendingOrders,
+                                                 const Channel &ch) {
+    size_t n = pairs.size();
+    size_t w = Batch::words(n);
+    const TempRecord &schema = records[pairs[0].first];
+
+    std::vector<std::vector<uint64_t> > obeys;
+    std::vector<std::vector<uint64_t> > eqs;
+    for (size_t f = 0; f < orderFields.size(); f++) {
+        int idx = schema.getIdx(orderFields[f]);
+        int type = schema.getType(idx);
+        bool last = f + 1 == orderFields.size();
+
+        // lt = r0 < r1, eq = r0 == r1
+        std::vector<uint64_t> lt, eq;
+        std::vector<uint64_t> a, b;
+        if (type == 1) {
+            gatherField(records, pairs, idx, true, a, b);
+            lt = Batch::and_(Batch::not_(a), b, ch);
+            eq.resize(w);
+            for (size_t i = 0; i < w; i++) {
+                eq[i] = a[i] ^ b[i];
+            }
+            eq = Batch::not_(std::move(eq));
+        } else {
+            gatherField(records, pairs, idx, false, a, b);
+            if (last) {
+                // no tie left to break, one direction is enough
+                obeys.push_back(ascendingOrders[f] ? Batch::lessThan(b, a, type, ch)
+                                                   : Batch::lessThan(a, b, type, ch));
+                break;
+            }
+            auto cmp = Batch::compare(a, b, type, ch);
+            lt.assign(cmp.begin(), cmp.begin() + static_cast<int64_t>(w));
+            eq.assign(cmp.begin() + static_cast<int64_t>(w), cmp.end());
+        }
+
+        // ascending fields swap when r0 > r1, that is neither lt nor eq, descending ones when r0 < r1
+        if (ascendingOrders[f]) {
+            std::vector<uint64_t> gt(w);
+            for (size_t i = 0; i < w; i++) {
+                gt[i] = lt[i] ^ eq[i];
+            }
+            obeys.push_back(Batch::not_(std::move(gt)));
+        } else {
+            obeys.push_back(std::move(lt));
+        }
+        eqs.push_back(std::move(eq));
+    }
+
+    // obey0 || (eq0 & (obey1 || (eq1 ... & obey_n))), the two sides of || never hold together
+    size_t size = orderFields.size();
+    std::vector<uint64_t> ret = obeys[size - 1];
+    for (size_t i = size - 2; i < size; --i) {
+        ret = Batch::and_(ret, eqs[i], ch);
+        for (size_t k = 0; k < w; k++) {
+            ret[k] ^= obeys[i][k];
+        }
+    }
+    return ret;
+}
+
+void Order::muxSwapBatched(std::vector<TempRecord> &records, const std::vector<std::pair<size_t, size_t> > &pairs,
+                           const std::vector<uint64_t> &swaps, const Channel &ch) {
+    size_t n = pairs.size();
+    size_t w = Batch::words(n);
+    const TempRecord &schema = records[pairs[0].first];
+
+    std::vector<int> intFields, bitFields;
+    for (int i = 0; i < schema._fieldValues.size(); i++) {
+        (schema.getType(i) == 1 ? bitFields : intFields).push_back(i);
+    }
+    // the valid bit travels with its record
+    bitFields.push_back(-1);
+
+    // integers: r0 += swap * (r1 - r0), r1 -= swap * (r1 - r0)
+    if (!intFields.empty()) {
+        auto arithSwaps = Batch::toArith(swaps, n, ch);
+        std::vector<uint64_t> conds, diffs;
+        std::vector<std::vector<uint64_t> > firsts, seconds;
+        for (int idx: intFields) {
+            std::vector<uint64_t> a, b;
+            gatherField(records, pairs, idx, false, a, b);
+            for (size_t k = 0; k < n; k++) {
+                diffs.push_back(b[k] - a[k]);
+            }
+            conds.insert(conds.end(), arithSwaps.begin(), arithSwaps.end());
+            firsts.push_back(std::move(a));
+            seconds.push_back(std::move(b));
+        }
+        auto t = Batch::mul(conds, diffs, ch);
+        for (size_t f = 0; f < intFields.size(); f++) {
+            for (size_t k = 0; k < n; k++) {
+                records[pairs[k].first].setShare(intFields[f], firsts[f][k] + t[f * n + k]);
+                records[pairs[k].second].setShare(intFields[f], seconds[f][k] - t[f * n + k]);
+            }
+        }
+    }
 
-    size_t paddingNum = 0;
-    if (!is_power_of_two(N)) {
+    // bits: r0 ^= swap & (r0 ^ r1), r1 ^= swap & (r0 ^ r1)
+    std::vector<uint64_t> conds, diffs;
+    std::vector<std::vector<uint64_t> > firsts, seconds;
+    for (int idx: bitFields) {
+        std::vector<uint64_t> a, b;
+        gatherField(records, pairs, idx, true, a, b);
+        for (size_t i = 0; i < w; i++) {
+            diffs.push_back(a[i] ^ b[i]);
+        }
+        conds.insert(conds.end(), swaps.begin(), swaps.end());
+        firsts.push_back(std::move(a));
+        seconds.push_back(std::move(b));
+    }
+    auto t = Batch::and_(conds, diffs, ch);
+    for (size_t f = 0; f < bitFields.size(); f++) {
+        for (size_t k = 0; k < n; k++) {
+            bool flip = (t[f * w + (k >> 6)] >> (k & 63)) & 1;
+            bool s0 = Batch::bit(firsts[f], k) ^ flip;
+            bool s1 = Batch::bit(seconds[f], k) ^ flip;
+            if (bitFields[f] < 0) {
+                records[pairs[k].first]._valid = BitSecret(s0);
+                records[pairs[k].second]._valid = BitSecret(s1);
+            } else {
+                records[pairs[k].first].setShare(bitFields[f], s0);
+                records[pairs[k].second].setShare(bitFields[f], s1);
+            }
+        }
+    }
+}
+
+// Run the comparators of one stage, where comparator (i, j) moves the record that comes first to i when its
+// direction is ascending and to j otherwise. Padding is placed in the clear and ranks after every record.
+// The comparators touch disjoint records, so every worker of `pool` takes a slice of them.
+static void stage(std::vector<TempRecord> &records, const std::vector<std::pair<size_t, size_t> > &comparators,
+                  const std::vector<bool> &directions, const std::vector<std::string> &fieldNames,
+                  const std::vector<bool> &ascendingOrders, WorkerPool &pool) {
+    std::vector<std::pair<size_t, size_t> > pairs;
+    std::vector<bool> dirs;
+    for (size_t c = 0; c < comparators.size(); c++) {
+        auto [i, ixj] = comparators[c];
+        bool dir = directions[c];
+        if (records[i]._padding && records[ixj]._padding) {
+            continue;
+        }
+        if (records[i]._padding || records[ixj]._padding) {
+            if ((dir && records[i]._padding) || (!dir && records[ixj]._padding)) {
+                std::swap(records[i], records[ixj]);
+            }
+            continue;
+        }
+        pairs.emplace_back(i, ixj);
+        dirs.push_back(dir);
+    }
+
+    size_t slices = std::min<size_t>(pool.size(), (pairs.size() + MIN_SLICE - 1) / MIN_SLICE);
+    pool.run([&](int worker, const Channel &ch) {
+        if (worker >= slices) {
+            return;
+        }
+        size_t lo = pairs.size() * worker / slices;
+        size_t hi = pairs.size() * (worker + 1) / slices;
+        std::vector<std::pair<size_t, size_t> > slice(pairs.begin() + static_cast<int64_t>(lo),
+                                                      pairs.begin() + static_cast<int64_t>(hi));
+
+        auto swaps = Order::requiresSwapBatched(records, slice, fieldNames, ascendingOrders, ch);
+        // invert swap condition if direction is descending
+        if (Comm::rank() == 0) {
+            for (size_t p = 0; p < slice.size(); p++) {
+                if (!dirs[lo + p]) {
+                    swaps[p >> 6] ^= 1ULL << (p & 63);
+                }
+            }
+        }
+        Order::muxSwapBatched(records, slice, swaps, ch);
+    });
+}
+
+// append padding records up to a multiple of `block`, returning how many
+static size_t pad(std::vector<TempRecord> &records, size_t block) {
+    size_t paddingNum = (block - records.size() % block) % block;
+    if (paddingNum > 0) {
         TempRecord padding = records[0];
         padding._padding = true;
-        size_t next_power = 1 << static_cast<size_t>(std::ceil(std::log2(N)));
-        records.resize(next_power, padding);
-        paddingNum = next_power - N;
-        N = next_power;
-    }
-
-    // Start with sequences of size 2 and double the size each time
-    for (size_t k = 2; k <= N; k <<= 1) {
-        // Start merging sequences from half of k and halve the size each time
-        for (size_t j = k >> 1; j > 0; j >>= 1) {
-            for (size_t i = 0; i < N; i++) {
-                size_t ixj = i ^ j;
-                if (ixj > i) {
-                    // Determine the direction of sorting
-                    bool dir = (i & k) == 0;
-                    if (records[i]._padding && records[ixj]._padding) {
-                        continue;
-                    }
-                    if (records[i]._padding || records[ixj]._padding) {
-                        // If dir is true (ascending), ensure non-padding is before padding
-                        // If dir is false (descending), ensure padding is before non-padding
-                        if ((dir && records[i]._padding) || (!dir && records[ixj]._padding)) {
-                            std::swap(records[i], records[ixj]);
-                        }
-                        continue;
+        records.resize(records.size() + paddingNum, padding);
+    }
+    return paddingNum;
+}
+
+// Pack the ordering fields into one key when their widths add up to 63 bits or less, so that every comparator
+// compares once instead of once per field. Each field is sign-extended and biased to an unsigned value once per
+// record, complemented when descending and shifted into place, the first field on top.
+// The key is inserted in front as an unnamed field, which getIdx("") finds before any other.
+// Returns the width to compare the key at, or 0 when the fields stay as they are.
+static int packKeys(std::vector<TempRecord> &records, const std::vector<std::string> &fieldNames,
+                    const std::vector<bool> &ascendingOrders, WorkerPool &pool) {
+    if (fieldNames.size() < 2 || records.empty()) {
+        return 0;
+    }
+    std::vector<int> idxs, widths;
+    int total = 0;
+    for (const auto &name: fieldNames) {
+        idxs.push_back(records[0].getIdx(name));
+        widths.push_back(records[0].getType(idxs.back()));
+        total += widths.back();
+    }
+    if (total > 63) {
+        return 0;
+    }
+
+    size_t n = records.size();
+    bool first = Comm::rank() == 0;
+    std::vector<uint64_t> keys(n);
+    size_t slices = std::min<size_t>(pool.size(), (n + MIN_SLICE - 1) / MIN_SLICE);
+    pool.run([&](int worker, const Channel &ch) {
+        if (worker >= slices) {
+            return;
+        }
+        size_t lo = n * worker / slices;
+        size_t m = n * (worker + 1) / slices - lo;
+        int offset = total;
+        for (size_t f = 0; f < idxs.size(); f++) {
+            offset -= widths[f];
+            std::vector<uint64_t> u(m);
+            if (widths[f] == 1) {
+                std::vector<uint64_t> bits(Batch::words(m));
+                for (size_t i = 0; i < m; i++) {
+                    Batch::setBit(bits, i, records[lo + i].share(idxs[f]) & 1);
+                }
+                u = Batch::toArith(bits, m, ch);
+            } else {
+                for (size_t i = 0; i < m; i++) {
+                    u[i] = records[lo + i].share(idxs[f]);
+                }
+                u = Batch::extend(u, widths[f], ch);
+                for (size_t i = 0; i < m; i++) {
+                    u[i] += first ? 1ULL << (widths[f] - 1) : 0;
+                }
+            }
+            uint64_t top = (1ULL << widths[f]) - 1;
+            for (size_t i = 0; i < m; i++) {
+                uint64_t v = ascendingOrders[f] ? u[i] : (first ? top : 0) - u[i];
+                keys[lo + i] += v << offset;
+            }
+        }
+    });
+
+    auto packed = records[0]._schema->insert(0, "", total + 1);
+    for (size_t i = 0; i < n; i++) {
+        records[i]._schema = packed;
+        records[i]._fieldValues.insert(records[i]._fieldValues.begin(),
+                                       IntSecret<int64_t>(static_cast<int64_t>(keys[i])));
+    }
+    return total + 1;
+}
+
+// drop the key of packKeys()
+static void unpackKeys(std::vector<TempRecord> &records, const std::shared_ptr<const Schema> &schema) {
+    for (auto &r: records) {
+        r._schema = schema;
+        r._fieldValues.erase(r._fieldValues.begin());
+    }
+}
+
+void Order::sortBatched(std::vector<TempRecord> &records, const std::vector<std::string> &fieldNames,
+                        const std::vector<bool> &ascendingOrders, int workers, SortingNetwork::Kind network) {
+    if (records.size() < 2) {
+        return;
+    }
+    WorkerPool pool(workers);
+    auto schema = records[0]._schema;
+    bool packed = packKeys(records, fieldNames, ascendingOrders, pool) > 0;
+    const auto &fields = packed ? std::vector<std::string>{""} : fieldNames;
+    const auto &ascendings = packed ? std::vector<bool>{true} : ascendingOrders;
+
+    auto schedule = SortingNetwork::of(records.size(), network);
+    std::vector<std::pair<size_t, size_t> > comparators;
+    std::vector<bool> dirs;
+    for (size_t s = 0; s < schedule->stages(); s++) {
+        schedule->stage(s, comparators);
+        dirs.assign(comparators.size(), true);
+        stage(records, comparators, dirs, fields, ascendings, pool);
+    }
+    if (packed) {
+        unpackKeys(records, schema);
+    }
+}
+
+void Order::topK(std::vector<TempRecord> &records, const std::vector<std::string> &fieldNames,
+                 const std::vector<bool> &ascendingOrders, size_t k, int workers, SortingNetwork::Kind network) {
+    // records failing WHERE rank after the others, through a leading BOOLEAN field of their valid bit
+    std::vector<std::string> fields = {""};
+    fields.insert(fields.end(), fieldNames.begin(), fieldNames.end());
+    std::vector<bool> ascendings = {false};
+    ascendings.insert(ascendings.end(), ascendingOrders.begin(), ascendingOrders.end());
+    if (records.empty()) {
+        return;
+    }
+    auto schema = records[0]._schema;
+    auto extended = schema->insert(0, "", 1);
+    for (auto &r: records) {
+        r._schema = extended;
+        r._fieldValues.insert(r._fieldValues.begin(), r._valid);
+    }
+
+    size_t K = std::bit_ceil(std::max<size_t>(k, 1));
+    if (K >= records.size()) {
+        sortBatched(records, fields, ascendings, workers, network);
+    } else {
+        WorkerPool pool(workers);
+        bool packed = packKeys(records, fields, ascendings, pool) > 0;
+        if (packed) {
+            fields = {""};
+            ascendings = {true};
+        }
+        pad(records, K);
+
+        // sort every block of K records ascending, all blocks share the stages
+        size_t N = records.size();
+        for (size_t size = 2; size <= K; size <<= 1) {
+            for (size_t j = size >> 1; j > 0; j >>= 1) {
+                std::vector<std::pair<size_t, size_t> > comparators;
+                std::vector<bool> dirs;
+                for (size_t i = 0; i < N; i++) {
+                    size_t ixj = i ^ j;
+                    if (ixj > i) {
+                        comparators.emplace_back(i, ixj);
+                        dirs.push_back((i & size) == 0 || size == K);
                     }
+                }
+                stage(records, comparators, dirs, fields, ascendings, pool);
+            }
+        }
 
-                    BitSecret swap = requiresSwap(records[i], records[ixj], fieldNames, ascendingOrders);
-                    // Invert swap condition if direction is descending
-                    if (!dir) {
-                        swap = swap.not_();
+        // Merge the blocks pairwise until one is left. Comparing a[i] with b[K - 1 - i] leaves the first K of both
+        // in a as a bitonic sequence, which log2(K) stages sort again. Block b is dropped.
+        while (records.size() > K) {
+            size_t blocks = records.size() / K;
+            std::vector<std::pair<size_t, size_t> > comparators;
+            for (size_t b = 0; b + 1 < blocks; b += 2) {
+                for (size_t i = 0; i < K; i++) {
+                    comparators.emplace_back(b * K + i, (b + 2) * K - 1 - i);
+                }
+            }
+            std::vector<bool> dirs(comparators.size(), true);
+            stage(records, comparators, dirs, fields, ascendings, pool);
+            for (size_t j = K >> 1; j > 0; j >>= 1) {
+                comparators.clear();
+                for (size_t b = 0; b + 1 < blocks; b += 2) {
+                    for (size_t i = b * K; i < (b + 1) * K; i++) {
+                        if ((i ^ j) > i) {
+                            comparators.emplace_back(i, i ^ j);
+                        }
                     }
-                    muxSwap(records[i], records[ixj], swap);
                 }
+                dirs.assign(comparators.size(), true);
+                stage(records, comparators, dirs, fields, ascendings, pool);
+            }
+
+            // keep the merged blocks and a last unpaired one
+            std::vector<TempRecord> kept;
+            kept.reserve((blocks + 1) / 2 * K);
+            for (size_t b = 0; b < blocks; b += 2) {
+                kept.insert(kept.end(), std::make_move_iterator(records.begin() + static_cast<int64_t>(b * K)),
+                            std::make_move_iterator(records.begin() + static_cast<int64_t>((b + 1) * K)));
+            }
+            records = std::move(kept);
+        }
+        if (packed) {
+            unpackKeys(records, extended);
+        }
+    }
+    records.resize(std::min(records.size(), k));
+
+    for (auto &r: records) {
+        r._schema = schema;
+        r._fieldValues.erase(r._fieldValues.begin());
+    }
+}
+
+// append the position of every record as an unnamed field shared in the clear, returning its type
+static int appendPosition(std::vector<TempRecord> &records) {
+    size_t n = records.size();
+    bool first = Comm::rank() == 0;
+    int type = n >> 31 ? 64 : 32;
+    auto extended = records[0]._schema->insert(static_cast<int>(records[0]._schema->_types.size()), "", type);
+    for (size_t i = 0; i < n; i++) {
+        records[i]._schema = extended;
+        records[i]._fieldValues.push_back(type == 32
+                                              ? FieldValue(IntSecret<int32_t>(static_cast<int32_t>(first ? i : 0)))
+                                              : FieldValue(IntSecret<int64_t>(static_cast<int64_t>(first ? i : 0))));
+    }
+    return type;
+}
+
+// Batch::shuffle over whole records: the integer fields as additive words, then the valid bit and the bit fields
+// packed into XOR words
+static void shuffleRecords(std::vector<TempRecord> &records, const Channel &ch) {
+    size_t n = records.size();
+    const Schema &schema = *records[0]._schema;
+    std::vector<int> intFields, bitFields;
+    for (int i = 0; i < schema._types.size(); i++) {
+        (schema._types[i] == 1 ? bitFields : intFields).push_back(i);
+    }
+    size_t ints = intFields.size();
+    size_t width = ints + Batch::words(bitFields.size() + 1);
+    std::vector<uint64_t> rows(n * width);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t *row = rows.data() + i * width;
+        for (size_t k = 0; k < ints; k++) {
+            row[k] = records[i].share(intFields[k]);
+        }
+        row[ints] = records[i]._valid.get();
+        for (size_t k = 0; k < bitFields.size(); k++) {
+            row[ints + ((k + 1) >> 6)] |= (records[i].share(bitFields[k]) & 1) << ((k + 1) & 63);
+        }
+    }
+    Batch::shuffle(rows, width, ints, ch);
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t *row = rows.data() + i * width;
+        for (size_t k = 0; k < ints; k++) {
+            records[i].setShare(intFields[k], row[k]);
+        }
+        records[i]._valid = BitSecret(row[ints] & 1);
+        for (size_t k = 0; k < bitFields.size(); k++) {
+            records[i].setShare(bitFields[k], (row[ints + ((k + 1) >> 6)] >> ((k + 1) & 63)) & 1);
+        }
+    }
+}
+
+void Order::shuffleSort(std::vector<TempRecord> &records, const std::vector<std::string> &fieldNames,
+                        const std::vector<bool> &ascendingOrders, int workers) {
+    size_t n = records.size();
+    if (n < 2) {
+        return;
+    }
+
+    // the original position as the last sort field
+    auto schema = records[0]._schema;
+    appendPosition(records);
+    std::vector<std::string> fields = fieldNames;
+    fields.emplace_back("");
+    std::vector<bool> ascendings = ascendingOrders;
+    ascendings.push_back(true);
+    shuffleRecords(records, Channel());
+
+    // Quicksort all parts at once, the first record of a part is its pivot.
+    // Comparator (i, pivot) tells whether record i comes after the pivot.
+    WorkerPool pool(workers);
+    std::vector<std::pair<size_t, size_t> > parts = {{0, n}};
+    while (!parts.empty()) {
+        std::vector<std::pair<size_t, size_t> > pairs;
+        for (auto [lo, hi]: parts) {
+            for (size_t i = lo + 1; i < hi; i++) {
+                pairs.emplace_back(i, lo);
+            }
+        }
+        std::vector<bool> after(pairs.size());
+        size_t slices = std::min<size_t>(pool.size(), (pairs.size() + MIN_SLICE - 1) / MIN_SLICE);
+        pool.run([&](int worker, const Channel &ch) {
+            if (worker >= slices) {
+                return;
+            }
+            size_t lo = pairs.size() * worker / slices;
+            size_t hi = pairs.size() * (worker + 1) / slices;
+            std::vector<std::pair<size_t, size_t> > slice(pairs.begin() + static_cast<int64_t>(lo),
+                                                          pairs.begin() + static_cast<int64_t>(hi));
+            auto bits = requiresSwapBatched(records, slice, fields, ascendings, ch);
+            auto other = ch.exchange(bits);
+            for (size_t p = 0; p < slice.size(); p++) {
+                after[lo + p] = ((bits[p >> 6] ^ other[p >> 6]) >> (p & 63)) & 1;
+            }
+        });
+
+        // records before the pivot, the pivot, then those after it
+        std::vector<std::pair<size_t, size_t> > next;
+        size_t p = 0;
+        for (auto [lo, hi]: parts) {
+            std::vector<TempRecord> before, behind;
+            for (size_t i = lo + 1; i < hi; i++, p++) {
+                (after[p] ? behind : before).push_back(std::move(records[i]));
+            }
+            size_t pivot = lo + before.size();
+            if (pivot != lo) {
+                std::swap(records[lo], records[pivot]);
             }
+            std::ranges::move(before, records.begin() + static_cast<int64_t>(lo));
+            std::ranges::move(behind, records.begin() + static_cast<int64_t>(pivot + 1));
+            if (before.size() > 1) {
+                next.emplace_back(lo, pivot);
+            }
+            if (behind.size() > 1) {
+                next.emplace_back(pivot + 1, hi);
+            }
+        }
+        parts = std::move(next);
+    }
+
+    for (auto &r: records) {
+        r._schema = schema;
+        r._fieldValues.pop_back();
+    }
+}
+
+void Order::keySort(std::vector<TempRecord> &records, const std::vector<std::string> &fieldNames,
+                    const std::vector<bool> &ascendingOrders, int workers) {
+    size_t n = records.size();
+    if (n < 2) {
+        return;
+    }
+    bool first = Comm::rank() == 0;
+
+    // the original position breaks ties, so the sorted order does not depend on where the shuffle put equal keys
+    auto schema = records[0]._schema;
+    int type = appendPosition(records);
+    shuffleRecords(records, Channel());
+
+    // key records: the ordering fields, the original position, then the position after the shuffle
+    std::vector<int> keyFields;
+    std::vector<std::string> names;
+    std::vector<int> types;
+    for (const auto &name: fieldNames) {
+        keyFields.push_back(records[0].getIdx(name));
+        names.push_back(name);
+        types.push_back(records[0].getType(keyFields.back()));
+    }
+    keyFields.push_back(static_cast<int>(schema->_types.size()));
+    names.insert(names.end(), {"", ""});
+    types.insert(types.end(), {type, type});
+    auto keySchema = std::make_shared<const Schema>(std::move(names), std::move(types));
+    std::vector<TempRecord> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i]._schema = keySchema;
+        keys[i]._fieldValues.reserve(keyFields.size() + 1);
+        for (int idx: keyFields) {
+            keys[i]._fieldValues.push_back(records[i]._fieldValues[idx]);
         }
+        keys[i]._fieldValues.push_back(type == 32
+                                           ? FieldValue(IntSecret<int32_t>(static_cast<int32_t>(first ? i : 0)))
+                                           : FieldValue(IntSecret<int64_t>(static_cast<int64_t>(first ? i : 0))));
+    }
+    std::vector<std::string> fields = fieldNames;
+    fields.emplace_back("");
+    std::vector<bool> ascendings = ascendingOrders;
+    ascendings.push_back(true);
+    sortBatched(keys, fields, ascendings, workers);
+
+    // Relative to the original order the shuffle is uniformly random, and so are the sorted positions after it.
+    // They are revealed and the records move in the clear.
+    int position = static_cast<int>(keyFields.size());
+    std::vector<uint64_t> mine(n);
+    for (size_t i = 0; i < n; i++) {
+        mine[i] = keys[i].share(position);
     }
-    records.erase(records.end() - paddingNum, records.end());
-}
\ No newline at end of file
+    auto other = Channel().exchange(mine);
+    uint64_t mask = type == 64 ? ~0ULL : (1ULL << type) - 1;
+    std::vector<TempRecord> sorted;
+    sorted.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        sorted.push_back(std::move(records[(mine[i] + other[i]) & mask]));
+    }
+    records = std::move(sorted);
+
+    for (auto &r: records) {
+        r._schema = schema;
+        r._fieldValues.pop_back();
+    }
+}
@@ -0,0 +1,67 @@
+#include "function/SortingNetwork.h"
+#include <bit>
+#include <map>
+#include <mutex>
+
+SortingNetwork::SortingNetwork(size_t n, Kind kind) {
+    this->_n = n;
+    this->_kind = kind;
+    size_t N = std::bit_ceil(std::max<size_t>(n, 1));
+    std::vector<std::pair<size_t, size_t> > comparators;
+    for (size_t block = 2; block <= N; block <<= 1) {
+        for (size_t distance = block >> 1; distance > 0; distance >>= 1) {
+            expand(block, distance, comparators);
+            if (!comparators.empty()) {
+                _stages.emplace_back(block, distance);
+            }
+        }
+    }
+}
+
+std::shared_ptr<const SortingNetwork> SortingNetwork::of(size_t n, Kind kind) {
+    static std::mutex mutex;
+    static std::map<std::pair<size_t, Kind>, std::shared_ptr<const SortingNetwork> > cache;
+    std::lock_guard lock(mutex);
+    auto &network = cache[{n, kind}];
+    if (!network) {
+        network = std::make_shared<const SortingNetwork>(n, kind);
+    }
+    return network;
+}
+
+SortingNetwork::Kind SortingNetwork::parse(const std::string &name) {
+    return name == "bitonic" ? BITONIC : ODD_EVEN_MERGE;
+}
+
+size_t SortingNetwork::stages() const {
+    return _stages.size();
+}
+
+void SortingNetwork::stage(size_t s, std::vector<std::pair<size_t, size_t> > &comparators) const {
+    expand(_stages[s].first, _stages[s].second, comparators);
+}
+
+void SortingNetwork::expand(size_t block, size_t distance, std::vector<std::pair<size_t, size_t> > &comparators) const {
+    comparators.clear();
+    if (_kind == BITONIC) {
+        // The first stage of a merge compares the two sorted halves of each block in reverse, which leaves a
+        // bitonic sequence in each half without sorting every other block descending. The next stages halve it.
+        for (size_t i = 0; i < _n; i++) {
+            size_t j = distance == block >> 1 ? i ^ (block - 1) : i ^ distance;
+            if (j > i && j < _n) {
+                comparators.emplace_back(i, j);
+            }
+        }
+    } else {
+        // stage (block, distance) merges the sorted halves of blocks of size `block`, comparing positions
+        // `distance` apart that lie in the same block and, after the first stage, in different sub-blocks
+        size_t half = block >> 1;
+        for (size_t j = distance % half; j + distance < _n; j += distance << 1) {
+            for (size_t i = j; i < j + distance && i + distance < _n; i++) {
+                if (i / block == (i + distance) / block) {
+                    comparators.emplace_back(i, i + distance);
+                }
+            }
+        }
+    }
+}
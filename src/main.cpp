@@ -5,13 +5,18 @@
 using json = nlohmann::json;
 #include "socket/LocalServer.h"
 #include "dbms/SystemManager.h"
+#include "secret/Dealer.h"
 
 int main(int argc, char **argv) {
     Comm::init(argc, argv);
+    // data directory of every rank: <dir>/<rank>, <dir> is the first argument.
+    // The second one limits the queries the client runs at once.
+    SystemManager::getInstance().open(std::string(argc > 1 ? argv[1] : "data") + "/" + std::to_string(Comm::rank()));
 
     if (Comm::rank() == Comm::CLIENT_RANK) {
+        Dealer::startPool();
         LocalServer &server = LocalServer::getInstance();
-        server.run();
+        server.run(argc > 2 ? std::stoi(argv[2]) : Scheduler::DEFAULT_LIMIT);
     } else {
         SystemManager::getInstance().serverExecute();
     }
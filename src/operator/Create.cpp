@@ -58,11 +58,10 @@ bool Create::clientCreateTable(std::ostringstream &resp, const hsql::SQLStatemen
 
     // notify servers
     json j;
-    j["type"] = SystemManager::getCommandPrefix(SystemManager::CREATE_TABLE);
     j["name"] = tableName;
     j["fieldNames"] = fieldNames;
     j["fieldTypes"] = fieldTypes;
-    SystemManager::notifyServersSync(j);
+    SystemManager::notifyServers(SystemManager::CREATE_TABLE, j);
 
     resp << "OK. Table `" + tableName + "` created." << std::endl;
     return true;
@@ -24,9 +24,8 @@ bool Drop::clientDropTable(std::ostringstream &resp, const hsql::SQLStatement *s
 
         // notify servers
         json j;
-        j["type"] = SystemManager::getCommandPrefix(SystemManager::DROP_TABLE);
         j["name"] = tableName;
-        SystemManager::notifyServersSync(j);
+        SystemManager::notifyServers(SystemManager::DROP_TABLE, j);
 
         resp << "OK. Table " + tableName + " dropped successfully." << std::endl;
         return true;
@@ -4,13 +4,79 @@
 
 #include "operator/Insert.h"
 
+#include <charconv>
 #include <sstream>
 #include <hsql/SQLParser.h>
 #include "basis/Table.h"
 #include "dbms/SystemManager.h"
+#include "secret/Profiler.h"
+#include "secret/Share.h"
+
+// columns named by the statement, or all of them
+static bool insertedColumns(std::ostringstream &resp, Table *table, const std::vector<char *> *columns,
+                            std::vector<std::string> &cols) {
+    const auto &fieldNames = table->fieldNames();
+    if (!columns) {
+        cols = fieldNames;
+        return true;
+    }
+    for (auto c: *columns) {
+        if (std::ranges::find(fieldNames, c) == fieldNames.end()) {
+            resp << "Failed. Unknown field name `" << c << "`." << std::endl;
+            return false;
+        }
+        cols.emplace_back(c);
+    }
+    return true;
+}
+
+// a literal of a VALUES tuple as parsed by hsql
+static bool parseValue(const hsql::Expr *expr, int64_t &v) {
+    if (expr->type == hsql::kExprLiteralInt) {
+        v = expr->ival;
+        return true;
+    }
+    if (expr->type == hsql::kExprOperator && expr->opType == hsql::kOpUnaryMinus
+        && expr->expr->type == hsql::kExprLiteralInt) {
+        v = -expr->expr->ival;
+        return true;
+    }
+    return false;
+}
+
+bool Insert::parseLiteral(std::string token, int64_t &v) {
+    std::ranges::transform(token, token.begin(), ::tolower);
+    if (token == "true" || token == "false") {
+        v = token == "true";
+        return true;
+    }
+    const char *begin = token.data() + (token.starts_with('+') ? 1 : 0);
+    const char *end = token.data() + token.size();
+    auto [p, ec] = std::from_chars(begin, end, v);
+    return ec == std::errc() && p == end && begin != end;
+}
+
+static std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? "" : s.substr(b, e - b + 1);
+}
+
+// position of the `values` keyword, or npos
+static size_t findValues(const std::string &command) {
+    std::string lower = command;
+    std::ranges::transform(lower, lower.begin(), ::tolower);
+    for (size_t pos = lower.find("values"); pos != std::string::npos; pos = lower.find("values", pos + 1)) {
+        bool before = pos == 0 || std::isspace(lower[pos - 1]) || lower[pos - 1] == ')';
+        bool after = pos + 6 == lower.size() || std::isspace(lower[pos + 6]) || lower[pos + 6] == '(';
+        if (before && after) {
+            return pos;
+        }
+    }
+    return std::string::npos;
+}
 
 bool Insert::clientInsert(std::ostringstream &resp, const hsql::SQLStatement *stmt) {
-    int done;
     const auto *insertStmt = dynamic_cast<const hsql::InsertStatement *>(stmt);
 
     std::string tableName = insertStmt->tableName;
@@ -19,93 +85,139 @@ bool Insert::clientInsert(std::ostringstream &resp, const hsql::SQLStatement *st
         resp << "Failed. Table `" + tableName + "` does not exist." << std::endl;
         return false;
     }
-    const auto fieldNames = table->fieldNames();
 
-    // get inserted values
-    const auto columns = insertStmt->columns;
-    const auto values = insertStmt->values;
     std::vector<std::string> cols;
+    if (!insertedColumns(resp, table, insertStmt->columns, cols)) {
+        return false;
+    }
 
-    // insert values all columns
-    if (!insertStmt->columns) {
-        cols = table->fieldNames();
-    } else {
-        for (auto c: *columns) {
-            cols.emplace_back(c);
+    std::vector<int64_t> row;
+    for (const auto *expr: *insertStmt->values) {
+        int64_t v;
+        if (!parseValue(expr, v)) {
+            resp << "Failed. Unsupported value type." << std::endl;
+            return false;
         }
+        row.push_back(v);
     }
+    return insertRows(resp, table, tableName, cols, {row});
+}
 
-    if (cols.size() != values->size()) {
-        resp << "Failed. Unmatched parameter numbers." << std::endl;
+bool Insert::clientInsertRows(std::ostringstream &resp, const std::string &command) {
+    size_t pos = findValues(command);
+    if (pos == std::string::npos) {
+        resp << "Failed. Syntax error: Missing VALUES." << std::endl;
         return false;
     }
-    for (auto &column: cols) {
-        if (std::ranges::find(fieldNames, column) == fieldNames.end()) {
-            resp << "Failed. Unknown field name `" + column + "`." << std::endl;
+
+    // split the tuples, literals never contain parentheses
+    std::vector<std::string> tuples;
+    size_t i = pos + 6;
+    while (true) {
+        size_t open = command.find_first_not_of(" \t\r\n", i);
+        if (open == std::string::npos || command[open] != '(') {
+            resp << "Failed. Syntax error: Expected `(` in VALUES." << std::endl;
+            return false;
+        }
+        size_t close = command.find(')', open);
+        if (close == std::string::npos) {
+            resp << "Failed. Syntax error: Unclosed `(` in VALUES." << std::endl;
             return false;
         }
+        tuples.push_back(command.substr(open + 1, close - open - 1));
+
+        size_t next = command.find_first_not_of(" \t\r\n", close + 1);
+        if (next == std::string::npos || command[next] == ';') {
+            break;
+        }
+        if (command[next] != ',') {
+            resp << "Failed. Syntax error: Expected `,` between VALUES tuples." << std::endl;
+            return false;
+        }
+        i = next + 1;
     }
 
-    std::vector<int64_t> parsedValues;
-    for (size_t i = 0; i < values->size(); ++i) {
-        const auto expr = (*values)[i];
-        int64_t v;
+    // let the SQL parser check the statement head with the first tuple
+    hsql::SQLParserResult result;
+    hsql::SQLParser::parse(command.substr(0, pos + 6) + " (" + tuples[0] + ")", &result);
+    if (!result.isValid() || result.getStatement(0)->type() != hsql::kStmtInsert) {
+        resp << "Failed. " << (result.isValid() ? "Syntax error." : result.errorMsg()) << std::endl;
+        return false;
+    }
+    const auto *insertStmt = dynamic_cast<const hsql::InsertStatement *>(result.getStatement(0));
+
+    std::string tableName = insertStmt->tableName;
+    Table *table = SystemManager::getInstance()._currentDatabase->getTable(tableName);
+    if (!table) {
+        resp << "Failed. Table `" + tableName + "` does not exist." << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> cols;
+    if (!insertedColumns(resp, table, insertStmt->columns, cols)) {
+        return false;
+    }
 
-        if (expr->type == hsql::kExprLiteralInt) {
-            v = expr->ival;
-        } else if (expr->type == hsql::kExprOperator && expr->expr->type == hsql::kExprLiteralInt) {
-            if (expr->opType == hsql::kOpUnaryMinus) {
-                v = -expr->expr->ival;
+    std::vector<std::vector<int64_t> > rows(tuples.size());
+    for (size_t r = 0; r < tuples.size(); r++) {
+        std::istringstream tuple(tuples[r]);
+        std::string token;
+        while (std::getline(tuple, token, ',')) {
+            int64_t v;
+            if (!parseLiteral(trim(token), v)) {
+                resp << "Failed. Unsupported value `" << trim(token) << "`." << std::endl;
+                return false;
             }
-        } else {
-            resp << "Failed. Unsupported value type." << std::endl;
-            return false;
+            rows[r].push_back(v);
         }
+    }
+    return insertRows(resp, table, tableName, cols, rows);
+}
+
+bool Insert::insertRows(std::ostringstream &resp, Table *table, const std::string &tableName,
+                        const std::vector<std::string> &cols, const std::vector<std::vector<int64_t> > &rows) {
+    const auto &fieldNames = table->fieldNames();
+    const auto &types = table->fieldTypes();
 
-        // column idx in the table
-        int64_t idx = std::distance(fieldNames.begin(),
-                                    std::find(fieldNames.begin(), fieldNames.end(), cols[i]));
-        int type = table->fieldTypes()[idx];
-        int64_t masked = v & ((1LL << type) - 1);
-        if (type < 64 && masked != v) {
-            resp << "Failed. Inserted parameters out of range." << std::endl;
+    // table field idx in the inserted columns, missing fields are 0
+    std::vector<int64_t> colIdxes;
+    for (const auto &f: fieldNames) {
+        colIdxes.push_back(std::distance(cols.begin(), std::ranges::find(cols, f)));
+    }
+
+    // values[field][row] in table order
+    std::vector<std::vector<int64_t> > values(fieldNames.size(), std::vector<int64_t>(rows.size()));
+    for (size_t r = 0; r < rows.size(); r++) {
+        if (rows[r].size() != cols.size()) {
+            resp << "Failed. Unmatched parameter numbers." << std::endl;
             return false;
         }
-        parsedValues.emplace_back(v);
+        for (size_t f = 0; f < fieldNames.size(); f++) {
+            int64_t v = colIdxes[f] < cols.size() ? rows[r][colIdxes[f]] : 0;
+            if (!Column::fits(v, types[f])) {
+                resp << "Failed. Inserted parameters out of range." << std::endl;
+                return false;
+            }
+            values[f][r] = v;
+        }
     }
 
     json j;
-    j["type"] = SystemManager::getCommandPrefix(SystemManager::INSERT);
     j["name"] = tableName;
-    std::string m = j.dump();
-
-    Comm::send(&m, 0);
-    Comm::send(&m, 1);
-
-    // secret share
-    for (size_t i = 0; i < table->fieldTypes().size(); ++i) {
-        int type = table->fieldTypes()[i];
-        // table field idx in the inserted columns
-        const auto &find = std::find(cols.begin(), cols.end(), fieldNames[i]);
-        int64_t idx = std::distance(cols.begin(), find);
-
-        int64_t v = find != cols.end() ? parsedValues[idx] : 0;
-        if (type == 1) {
-            BitSecret(v).share();
-        } else if (type == 8) {
-            IntSecret(static_cast<int8_t>(v)).share();
-        } else if (type == 16) {
-            IntSecret(static_cast<int16_t>(v)).share();
-        } else if (type == 32) {
-            IntSecret(static_cast<int32_t>(v)).share();
-        } else {
-            IntSecret(v).share();
-        }
+    SystemManager::notifyServers(SystemManager::INSERT, j);
+
+    // secret share every column of the batch in one message per server
+    {
+        Profiler::Scope scope("insert");
+        Share::send(values, types, Channel());
     }
 
-    Comm::recv(&done, 0);
-    Comm::recv(&done, 1);
-    resp << "OK. Record inserted into `" + tableName + "`." << std::endl;
+    // the servers append the batch in order with later commands, no need to wait for them
+    if (rows.size() == 1) {
+        resp << "OK. Record inserted into `" + tableName + "`." << std::endl;
+    } else {
+        resp << "OK. " << rows.size() << " records inserted into `" + tableName + "`." << std::endl;
+    }
 
     return true;
 }
@@ -114,25 +226,6 @@ void Insert::serverInsert(nlohmann::basic_json<> j) {
     std::string tbName = j.at("name").get<std::string>();
     Table *table = SystemManager::getInstance()._currentDatabase->getTable(tbName);
 
-    std::vector<int> types = table->fieldTypes();
-    TableRecord r(table);
-    for (int t: types) {
-        if (t == 1) {
-            BitSecret s = BitSecret(false).share();
-            r.addField(s, t);
-        } else if (t == 8) {
-            IntSecret s = IntSecret<int8_t>(0).share();
-            r.addField(s, t);
-        } else if (t == 16) {
-            IntSecret s = IntSecret<int16_t>(0).share();
-            r.addField(s, t);
-        } else if (t == 32) {
-            IntSecret s = IntSecret<int32_t>(0).share();
-            r.addField(s, t);
-        } else {
-            IntSecret s = IntSecret<int64_t>(0).share();
-            r.addField(s, t);
-        }
-    }
-    table->insert(r);
-}
\ No newline at end of file
+    Profiler::Scope scope("insert");
+    table->insert(Share::recv(table->fieldTypes(), Channel()));
+}
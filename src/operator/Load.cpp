@@ -0,0 +1,225 @@
+#include "operator/Load.h"
+
+#include <fstream>
+#include <iomanip>
+
+#include "basis/Table.h"
+#include "dbms/SystemManager.h"
+#include "operator/Insert.h"
+#include "secret/Profiler.h"
+#include "secret/Share.h"
+
+// what follows on the channel: the shares of a chunk, or the end of the load
+enum LoadState : int64_t {
+    CHUNK,
+    COMMIT,
+    ABORT
+};
+
+static void notify(LoadState state, const Channel &ch) {
+    std::vector<int64_t> m = {state};
+    ch.send(m, 0);
+    ch.send(m, 1);
+}
+
+static bool expect(std::istringstream &iss, const char *keyword, std::ostringstream &resp) {
+    std::string word;
+    iss >> word;
+    if (strcasecmp(word.c_str(), keyword) != 0) {
+        resp << "Failed. Syntax error: Expected `" << keyword << "`." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static size_t recordBytes(const std::vector<int> &types) {
+    size_t bytes = 0;
+    for (int t: types) {
+        bytes += t == 1 ? 1 : t >> 3;
+    }
+    return bytes;
+}
+
+// fill chunk[field][row] with up to CHUNK_ROWS csv records, `line` counts the lines read
+static bool readCsv(std::ifstream &in, const std::vector<int> &types, std::vector<std::vector<int64_t> > &chunk,
+                    size_t &line, std::ostringstream &resp) {
+    std::string text;
+    while (chunk[0].size() < Load::CHUNK_ROWS && std::getline(in, text)) {
+        line++;
+        if (!text.empty() && text.back() == '\r') {
+            text.pop_back();
+        }
+        if (text.find_first_not_of(" \t") == std::string::npos) {
+            continue;
+        }
+        std::istringstream fields(text);
+        std::string token;
+        size_t f = 0;
+        while (std::getline(fields, token, ',')) {
+            token.erase(0, token.find_first_not_of(" \t"));
+            token.erase(token.find_last_not_of(" \t") + 1);
+            int64_t v;
+            if (f == types.size() || !Insert::parseLiteral(token, v) || !Column::fits(v, types[f])) {
+                break;
+            }
+            chunk[f++].push_back(v);
+        }
+        if (f != types.size() || !fields.eof()) {
+            resp << "Failed. Invalid record at line " << line << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// fill chunk[field][row] with up to CHUNK_ROWS binary records, `line` counts the records read
+static bool readBinary(std::ifstream &in, const std::vector<int> &types, std::vector<std::vector<int64_t> > &chunk,
+                       size_t &line, std::ostringstream &resp) {
+    size_t size = recordBytes(types);
+    std::vector<char> buffer(size * Load::CHUNK_ROWS);
+    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    size_t bytes = in.gcount();
+    if (bytes % size != 0) {
+        resp << "Failed. Truncated record " << line + bytes / size + 1 << "." << std::endl;
+        return false;
+    }
+
+    const char *p = buffer.data();
+    for (size_t r = 0; r < bytes / size; r++) {
+        line++;
+        for (size_t f = 0; f < types.size(); f++) {
+            int64_t v;
+            switch (types[f]) {
+                case 1:
+                case 8:
+                    v = *reinterpret_cast<const int8_t *>(p);
+                    break;
+                case 16:
+                    v = *reinterpret_cast<const int16_t *>(p);
+                    break;
+                case 32:
+                    v = *reinterpret_cast<const int32_t *>(p);
+                    break;
+                default:
+                    v = *reinterpret_cast<const int64_t *>(p);
+                    break;
+            }
+            if (!Column::fits(v, types[f])) {
+                resp << "Failed. Invalid record " << line << "." << std::endl;
+                return false;
+            }
+            chunk[f].push_back(v);
+            p += types[f] == 1 ? 1 : types[f] >> 3;
+        }
+    }
+    return true;
+}
+
+bool Load::clientLoad(std::ostringstream &resp, std::istringstream &iss) {
+    std::string path, tableName, word;
+    if (!expect(iss, "data", resp) || !expect(iss, "infile", resp)) {
+        return false;
+    }
+    iss >> std::quoted(path, '\'');
+    if (!expect(iss, "into", resp) || !expect(iss, "table", resp)) {
+        return false;
+    }
+    iss >> tableName;
+
+    bool binary = false;
+    size_t ignore = 0;
+    while (!tableName.empty() && tableName.back() != ';' && iss >> word) {
+        if (strcasecmp(word.c_str(), "format") == 0) {
+            iss >> word;
+            binary = strncasecmp(word.c_str(), "binary", 6) == 0;
+            if (!binary && strncasecmp(word.c_str(), "csv", 3) != 0) {
+                resp << "Failed. Unknown format `" << word << "`." << std::endl;
+                return false;
+            }
+        } else if (strcasecmp(word.c_str(), "ignore") == 0) {
+            iss >> ignore >> word;
+            if (iss.fail() || strncasecmp(word.c_str(), "lines", 5) != 0) {
+                resp << "Failed. Syntax error: Expected `ignore <n> lines`." << std::endl;
+                return false;
+            }
+        } else if (word != ";") {
+            resp << "Failed. Syntax error: Unexpected `" << word << "`." << std::endl;
+            return false;
+        }
+        if (word.back() == ';') {
+            break;
+        }
+    }
+    if (!tableName.empty() && tableName.back() == ';') {
+        tableName.pop_back();
+    }
+
+    Table *table = SystemManager::getInstance()._currentDatabase->getTable(tableName);
+    if (!table) {
+        resp << "Failed. Table `" + tableName + "` does not exist." << std::endl;
+        return false;
+    }
+    std::ifstream in(path, binary ? std::ios::binary : std::ios::in);
+    if (!in) {
+        resp << "Failed. Cannot open `" << path << "`." << std::endl;
+        return false;
+    }
+    const auto &types = table->fieldTypes();
+    size_t line = 0;
+    if (binary) {
+        // records play the role of lines
+        in.ignore(static_cast<std::streamsize>(ignore * recordBytes(types)));
+        line = ignore;
+    }
+    for (std::string skipped; line < ignore && std::getline(in, skipped); line++) {
+    }
+
+    json j;
+    j["name"] = tableName;
+    SystemManager::notifyServers(SystemManager::LOAD, j);
+
+    // one chunk of plain values at a time, sent before the next is read
+    Profiler::Scope scope("load");
+    Channel ch;
+    std::vector<std::vector<int64_t> > chunk(types.size());
+    size_t loaded = 0;
+    bool ok;
+    while (true) {
+        for (auto &c: chunk) {
+            c.clear();
+        }
+        ok = binary ? readBinary(in, types, chunk, line, resp) : readCsv(in, types, chunk, line, resp);
+        if (!ok || chunk[0].empty()) {
+            break;
+        }
+        notify(CHUNK, ch);
+        Share::send(chunk, types, ch);
+        loaded += chunk[0].size();
+    }
+    notify(ok ? COMMIT : ABORT, ch);
+
+    if (ok) {
+        resp << "OK. " << loaded << " records loaded into `" + tableName + "`." << std::endl;
+    }
+    return ok;
+}
+
+void Load::serverLoad(nlohmann::basic_json<> j) {
+    std::string tbName = j.at("name").get<std::string>();
+    Table *table = SystemManager::getInstance()._currentDatabase->getTable(tbName);
+
+    Profiler::Scope scope("load");
+    Channel ch;
+    size_t before = table->size();
+    while (true) {
+        auto state = ch.recv<int64_t>(Comm::CLIENT_RANK)[0];
+        if (state == CHUNK) {
+            table->insert(Share::recv(table->fieldTypes(), ch));
+            continue;
+        }
+        if (state == ABORT) {
+            table->truncate(before);
+        }
+        return;
+    }
+}
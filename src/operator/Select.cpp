@@ -8,13 +8,48 @@
 #include <nlohmann/json.hpp>
 
 #include "dbms/SystemManager.h"
+#include "function/Aggregate.h"
+#include "function/Compact.h"
+#include "function/Filter.h"
+#include "function/Join.h"
 #include "function/Order.h"
+#include "secret/Batch.h"
+#include "secret/Dealer.h"
+#include "secret/Profiler.h"
+#include "secret/Reveal.h"
+#include "secret/WorkerPool.h"
 using json = nlohmann::json;
 
-bool Select::clientSelect(std::ostringstream &resp, const hsql::SQLStatement *stmt) {
-    int done;
+// LIMIT and OFFSET of `selectStmt`, `limit` is -1 without LIMIT
+static bool encodeLimit(std::ostringstream &resp, const hsql::SelectStatement *selectStmt, int64_t &limit,
+                        int64_t &offset) {
+    limit = -1;
+    offset = 0;
+    if (!selectStmt->limit) {
+        return true;
+    }
+    const auto *l = selectStmt->limit->limit;
+    const auto *o = selectStmt->limit->offset;
+    if ((l && (l->type != hsql::kExprLiteralInt || l->ival < 0))
+        || (o && (o->type != hsql::kExprLiteralInt || o->ival < 0))) {
+        resp << "Failed. LIMIT and OFFSET take non-negative integers." << std::endl;
+        return false;
+    }
+    limit = l ? l->ival : -1;
+    offset = o ? o->ival : 0;
+    return true;
+}
+
+// whether the `row`-th result row lies within OFFSET and LIMIT
+static bool shown(size_t row, int64_t limit, int64_t offset) {
+    return row >= offset && (limit < 0 || row < offset + limit);
+}
 
+bool Select::clientSelect(std::ostringstream &resp, const hsql::SQLStatement *stmt) {
     const auto *selectStmt = dynamic_cast<const hsql::SelectStatement *>(stmt);
+    if (selectStmt->fromTable->type == hsql::kTableJoin) {
+        return clientJoin(resp, selectStmt);
+    }
 
     std::string tableName = selectStmt->fromTable->getName();
 
@@ -28,21 +63,54 @@ bool Select::clientSelect(std::ostringstream &resp, const hsql::SQLStatement *st
     // select content
     std::vector<std::string> selectedFieldNames;
     const auto list = selectStmt->selectList;
+    json aggregates;
+    std::vector<std::string> labels;
+    std::vector<std::string> groupFields;
+    if (selectStmt->groupBy) {
+        if (selectStmt->groupBy->having) {
+            resp << "Failed. HAVING is not supported." << std::endl;
+            return false;
+        }
+        for (const auto *c: *selectStmt->groupBy->columns) {
+            if (c->type != hsql::kExprColumnRef || std::ranges::find(fieldNames, c->getName()) == fieldNames.end()) {
+                resp << "Failed. GROUP BY takes fields of the table." << std::endl;
+                return false;
+            }
+            groupFields.emplace_back(c->getName());
+        }
+    }
+    if ((selectStmt->groupBy || Aggregate::contains(list))
+        && !Aggregate::encode(resp, list, table, groupFields, aggregates, labels)) {
+        return false;
+    }
     for (const auto c: *list) {
+        if (!aggregates.is_null()) {
+            break;
+        }
         // select *
         if (c->type == hsql::kExprStar) {
             selectedFieldNames = table->fieldNames();
             break;
         }
         if (c->type == hsql::kExprColumnRef) {
+            if (std::ranges::find(fieldNames, c->getName()) == fieldNames.end()) {
+                resp << "Failed. Table does not have field `" << c->getName() << "`." << std::endl;
+                return false;
+            }
             selectedFieldNames.emplace_back(c->getName());
         }
     }
 
-    // order
+    // where
+    json where;
+    if (selectStmt->whereClause && !Filter::encode(resp, selectStmt->whereClause, table, where)) {
+        return false;
+    }
+
+    // order, aggregates give a single row and groups come sorted by their fields
     std::vector<std::string> orderFields;
     std::vector<bool> ascendings;
-    if (selectStmt->order) {
+    if (selectStmt->order && aggregates.is_null()) {
         const auto *order = selectStmt->order;
         for (auto desc: *order) {
             auto name = desc->expr->getName();
@@ -56,112 +124,404 @@ bool Select::clientSelect(std::ostringstream &resp, const hsql::SQLStatement *st
         }
     }
 
-    // notify servers
+    int64_t limit, offset;
+    if (!encodeLimit(resp, selectStmt, limit, offset)) {
+        return false;
+    }
+
+    // notify servers, the query runs in the slot of this thread
     json j;
-    j["type"] = SystemManager::getCommandPrefix(SystemManager::SELECT);
+    j["database"] = SystemManager::getInstance()._currentDatabase->name();
+    j["slot"] = Channel::slot();
     j["name"] = tableName;
     j["fieldNames"] = selectedFieldNames;
-    if (selectStmt->order) {
+    if (selectStmt->whereClause) {
+        j["where"] = where;
+    }
+    j["compaction"] = SystemManager::getInstance()._settings["compaction"];
+    if (!aggregates.is_null()) {
+        j["aggregates"] = aggregates;
+    }
+    if (!groupFields.empty()) {
+        j["groupFields"] = groupFields;
+        j["workers"] = SystemManager::getInstance()._settings["workers"];
+    }
+    if (!orderFields.empty()) {
         j["orderFields"] = orderFields;
         j["ascendings"] = ascendings;
+        j["sortMode"] = SystemManager::getInstance()._settings["sort_mode"];
+        j["sortNetwork"] = SystemManager::getInstance()._settings["sort_network"];
+        j["workers"] = SystemManager::getInstance()._settings["workers"];
+    }
+    // the servers keep the first records up to the end of the window
+    if (limit >= 0 && aggregates.is_null()) {
+        j["limit"] = limit + offset;
     }
-    std::string m = j.dump();
-    Comm::send(&m, 0);
-    Comm::send(&m, 1);
-
-    std::vector<TempRecord> rawRecords;
-    int64_t c;
-    Comm::recv(&c, 0);
-    auto count = static_cast<uint64_t>(c);
-
-    for (int i = 0; i < count; i++) {
-        TempRecord temp;
-        for (const auto &selectedField: selectedFieldNames) {
-            // column idx in the table
-            int64_t idx = std::distance(fieldNames.begin(),
-                                        std::ranges::find(fieldNames, selectedField));
-            int type = table->fieldTypes()[idx];
-            if (type == 1) {
-                temp.addField(BitSecret(false).reconstruct(), type);
-            } else if (type == 8) {
-                temp.addField(IntSecret<int8_t>(0).reconstruct(), type);
-            } else if (type == 16) {
-                temp.addField(IntSecret<int16_t>(0).reconstruct(), type);
-            } else if (type == 32) {
-                temp.addField(IntSecret<int32_t>(0).reconstruct(), type);
-            } else {
-                temp.addField(IntSecret<int64_t>(0).reconstruct(), type);
+    SystemManager::notifyServers(SystemManager::SELECT, j);
+
+    // deal correlated randomness until the servers finished computing
+    Dealer::serve();
+
+    if (!aggregates.is_null()) {
+        // groups come with the bits marking the records that output them
+        auto types = Aggregate::types(aggregates);
+        if (!groupFields.empty()) {
+            types.push_back(1);
+        }
+        std::vector<std::vector<int64_t> > values;
+        {
+            Profiler::Scope scope("reveal");
+            values = Reveal::recv(types, Channel());
+        }
+        if (values.empty()) {
+            resp << "Failed. The servers could not run the query." << std::endl;
+            return false;
+        }
+        for (const auto &label: labels) {
+            resp << std::setw(10) << label;
+        }
+        resp << std::endl;
+        size_t rows = groupFields.empty() ? 1 : values.back().size();
+        for (size_t i = 0, row = 0; i < rows; i++) {
+            if ((!groupFields.empty() && !values.back()[i]) || !shown(row++, limit, offset)) {
+                continue;
+            }
+            for (const auto &v: Aggregate::format(aggregates, values, i)) {
+                resp << std::setw(10) << v;
             }
+            resp << std::endl;
         }
+        return true;
+    }
 
-        BitSecret b = BitSecret(false).reconstruct();
-        if (b.get()) {
-            rawRecords.push_back(temp);
-        }
+    // selected columns followed by the valid bits
+    std::vector<int> types;
+    for (const auto &selectedField: selectedFieldNames) {
+        int64_t idx = std::distance(fieldNames.begin(), std::ranges::find(fieldNames, selectedField));
+        types.push_back(table->fieldTypes()[idx]);
+    }
+    types.push_back(1);
+    std::vector<std::vector<int64_t> > values;
+    {
+        Profiler::Scope scope("reveal");
+        values = Reveal::recv(types, Channel());
     }
+    if (values.empty()) {
+        resp << "Failed. The servers could not run the query." << std::endl;
+        return false;
+    }
+    const auto &valid = values.back();
 
-    for (const auto &field: table->fieldNames()) {
+    for (const auto &field: selectedFieldNames) {
         resp << std::setw(10) << field;
     }
     resp << std::endl;
 
-    for (const auto &record: rawRecords) {
-        record.print(resp);
+    for (size_t i = 0, row = 0; i < valid.size(); i++) {
+        if (!valid[i] || !shown(row++, limit, offset)) {
+            continue;
+        }
+        for (size_t f = 0; f < selectedFieldNames.size(); f++) {
+            resp << std::setw(10) << values[f][i];
+        }
+        resp << std::endl;
     }
+    return true;
+}
 
-    Comm::recv(&done, 0);
-    Comm::recv(&done, 1);
+bool Select::clientJoin(std::ostringstream &resp, const hsql::SelectStatement *selectStmt) {
+    json j;
+    std::vector<std::string> labels;
+    std::vector<int> types;
+    int64_t limit, offset;
+    if (!Join::encode(resp, selectStmt, SystemManager::getInstance()._currentDatabase, j, labels, types)
+        || !encodeLimit(resp, selectStmt, limit, offset)) {
+        return false;
+    }
+    j["database"] = SystemManager::getInstance()._currentDatabase->name();
+    j["slot"] = Channel::slot();
+    j["join"] = true;
+    j["workers"] = SystemManager::getInstance()._settings["workers"];
+    j["compaction"] = SystemManager::getInstance()._settings["compaction"];
+    if (limit >= 0) {
+        j["limit"] = limit + offset;
+    }
+    SystemManager::notifyServers(SystemManager::SELECT, j);
+
+    Dealer::serve();
+
+    // output columns followed by the bits marking the joined records
+    types.push_back(1);
+    std::vector<std::vector<int64_t> > values;
+    {
+        Profiler::Scope scope("reveal");
+        values = Reveal::recv(types, Channel());
+    }
+    if (values.empty()) {
+        resp << "Failed. The servers could not run the query." << std::endl;
+        return false;
+    }
+    for (const auto &label: labels) {
+        resp << std::setw(10) << label;
+    }
+    resp << std::endl;
+    const auto &joined = values.back();
+    for (size_t i = 0, row = 0; i < joined.size(); i++) {
+        if (!joined[i] || !shown(row++, limit, offset)) {
+            continue;
+        }
+        for (size_t c = 0; c < labels.size(); c++) {
+            resp << std::setw(10) << values[c][i];
+        }
+        resp << std::endl;
+    }
     return true;
 }
 
+// position of field `idx` of the table among the projected `fields`, which gain it when missing
+static int project(std::vector<int> &fields, int idx) {
+    auto it = std::ranges::find(fields, idx);
+    if (it != fields.end()) {
+        return static_cast<int>(std::distance(fields.begin(), it));
+    }
+    fields.push_back(idx);
+    return static_cast<int>(fields.size()) - 1;
+}
+
+// records of `table` holding only `fields`, those failing the where clause stay in place with a shared invalid bit
+static std::vector<TempRecord> scan(const Table *table, const std::vector<int> &fields,
+                                    const std::vector<uint64_t> &matches) {
+    Profiler::Scope scope("scan");
+    auto records = table->select(fields);
+    if (!matches.empty()) {
+        for (size_t i = 0; i < records.size(); i++) {
+            records[i]._valid = BitSecret(Batch::bit(matches, i));
+        }
+    }
+    return records;
+}
+
+// Move the valid rows of `columns`, whose last column holds the valid bits, to the front and drop the others as
+// the compaction setting of the client asks, or exactly when it is off and `always`.
+// `columns` then point into `compacted`, unless nothing was compacted.
+static void compact(const json &j, std::vector<const Column *> &columns, std::vector<Column> &compacted,
+                    bool always = false) {
+    std::string mode = j.at("compaction").get<std::string>();
+    if (mode == "off" && !always) {
+        return;
+    }
+    Profiler::Scope scope("compact");
+    int64_t limit = j.contains("limit") ? j.at("limit").get<int64_t>() : -1;
+    compacted = Compact::evaluate(columns, mode == "padded", limit, Channel());
+    for (size_t c = 0; c < columns.size(); c++) {
+        columns[c] = &compacted[c];
+    }
+}
+
+void Select::serverJoin(const json &j) {
+    auto *database = SystemManager::getInstance()._currentDatabase;
+    const Table *left = database->getTable(j.at("left").get<std::string>());
+    const Table *right = database->getTable(j.at("right").get<std::string>());
+    if (!left || !right) {
+        Dealer::finish();
+        Reveal::fail(Channel());
+        return;
+    }
+
+    std::vector<uint64_t> matches[2];
+    if (j.contains("where")) {
+        Profiler::Scope scope("filter");
+        int side = j.at("whereSide").get<int>();
+        matches[side] = Filter::evaluate(j.at("where"), side ? right : left, Channel());
+    }
+
+    std::vector<Column> output;
+    {
+        Profiler::Scope scope("join");
+        output = Join::evaluate(j, left, right, matches[0], matches[1],
+                                WorkerPool::agreedSize(j.at("workers").get<std::string>()), Channel());
+    }
+    std::vector<const Column *> columns;
+    for (const auto &c: output) {
+        columns.push_back(&c);
+    }
+    std::vector<Column> compacted;
+    compact(j, columns, compacted);
+    Dealer::finish();
+
+    Profiler::Scope scope("reveal");
+    Reveal::send(columns, Channel());
+}
+
 void Select::serverSelect(json j) {
+    if (j.contains("join")) {
+        serverJoin(j);
+        return;
+    }
     std::string tableName = j.at("name").get<std::string>();
     std::vector<std::string> selectedFields = j.at("fieldNames").get<std::vector<std::string> >();
 
     Table *table = SystemManager::getInstance()._currentDatabase->getTable(tableName);
-    std::vector<TempRecord> records = table->selectAll();
+    if (!table) {
+        Dealer::finish();
+        Reveal::fail(Channel());
+        return;
+    }
 
-    // order
-    if (j.contains("orderFields")) {
-        std::vector<std::string> orderFields = j.at("orderFields").get<std::vector<std::string> >();
-        std::vector<bool> ascendings = j.at("ascendings").get<std::vector<bool> >();
+    // column indexes in the table
+    const auto fieldNames = table->fieldNames();
+    std::vector<int64_t> selectedIdxes;
+    for (const auto &selectedField: selectedFields) {
+        selectedIdxes.push_back(std::distance(fieldNames.begin(), std::ranges::find(fieldNames, selectedField)));
+    }
 
-        std::vector<BitSecret> ascs;
-        ascs.reserve(ascendings.size());
+    // records failing the where clause stay in place with a shared invalid bit
+    std::vector<uint64_t> matches;
+    if (j.contains("where")) {
+        Profiler::Scope scope("filter");
+        matches = Filter::evaluate(j.at("where"), table, Channel());
+    }
 
-        for (bool a: ascendings) {
-            ascs.emplace_back(a & Comm::rank());
+    // only the aggregates are revealed
+    if (j.contains("aggregates")) {
+        std::vector<Column> output;
+        if (j.contains("groupFields")) {
+            // only the grouping and aggregated fields go through the sort
+            auto groupFields = j.at("groupFields").get<std::vector<std::string> >();
+            std::vector<int> fields;
+            for (const auto &name: groupFields) {
+                project(fields, static_cast<int>(std::distance(fieldNames.begin(), std::ranges::find(fieldNames, name))));
+            }
+            json aggregates = j.at("aggregates");
+            for (auto &a: aggregates) {
+                if (a.contains("field")) {
+                    a["field"] = project(fields, a.at("field").get<int>());
+                }
+            }
+            auto records = scan(table, fields, matches);
+            Profiler::Scope scope("group");
+            output = Aggregate::evaluateGroups(aggregates, groupFields, records,
+                                               WorkerPool::agreedSize(j.at("workers").get<std::string>()), Channel());
+        } else {
+            Profiler::Scope scope("aggregate");
+            output = Aggregate::evaluate(j.at("aggregates"), table, matches, Channel());
+        }
+        std::vector<const Column *> columns;
+        for (const auto &c: output) {
+            columns.push_back(&c);
         }
-        Order::bitonicSort(records, orderFields, ascs);
+        // groups come with the bits marking the records that output them. Where those bits lie in the sorted
+        // records tells the group sizes, so groups are compacted whatever the setting.
+        std::vector<Column> compacted;
+        if (j.contains("groupFields")) {
+            compact(j, columns, compacted, true);
+        }
+        Dealer::finish();
+        Profiler::Scope scope("reveal");
+        Reveal::send(columns, Channel());
+        return;
     }
 
-    auto count = static_cast<int64_t>(records.size());
-    if (Comm::rank() == 0) {
-        Comm::send(&count, Comm::CLIENT_RANK);
+    // no operator reorders rows, so reveal straight from the column buffers
+    if (!j.contains("orderFields")) {
+        // without WHERE the first records are the result, with it any record may be among them
+        size_t rows = table->size();
+        if (j.contains("limit") && matches.empty()) {
+            rows = std::min<size_t>(rows, j.at("limit").get<int64_t>());
+        }
+        Column valid(1);
+        valid.reserve(rows);
+        for (size_t i = 0; i < rows; i++) {
+            valid.append(matches.empty() ? Comm::rank() : Batch::bit(matches, i));
+        }
+        std::vector<Column> prefixes;
+        prefixes.reserve(selectedIdxes.size());
+        std::vector<const Column *> columns;
+        for (int64_t idx: selectedIdxes) {
+            const Column &c = table->column(static_cast<int>(idx));
+            if (rows == table->size()) {
+                columns.push_back(&c);
+                continue;
+            }
+            prefixes.emplace_back(c.type());
+            prefixes.back().reserve(rows);
+            for (size_t i = 0; i < rows; i++) {
+                prefixes.back().append(c.get(i));
+            }
+            columns.push_back(&prefixes.back());
+        }
+        columns.push_back(&valid);
+        // every record passes without WHERE
+        std::vector<Column> compacted;
+        if (!matches.empty()) {
+            compact(j, columns, compacted);
+        }
+        Dealer::finish();
+        Profiler::Scope scope("reveal");
+        Reveal::send(columns, Channel());
+        return;
     }
 
-    const auto fieldNames = table->fieldNames();
-    for (int i = 0; i < count; i++) {
-        TempRecord &cur = records[i];
-
-        for (const auto &selectedField: selectedFields) {
-            // column index in the table
-            int64_t idx = std::distance(fieldNames.begin(),
-                                        std::ranges::find(fieldNames, selectedField));
-            int t = table->fieldTypes()[idx];
-            if (t == 1) {
-                std::get<BitSecret>(cur._fieldValues[idx]).reconstruct();
-            } else if (t == 8) {
-                std::get<IntSecret<int8_t> >(cur._fieldValues[idx]).reconstruct();
-            } else if (t == 16) {
-                std::get<IntSecret<int16_t> >(cur._fieldValues[idx]).reconstruct();
-            } else if (t == 32) {
-                std::get<IntSecret<int32_t> >(cur._fieldValues[idx]).reconstruct();
-            } else {
-                std::get<IntSecret<int64_t> >(cur._fieldValues[idx]).reconstruct();
+    // order, only the selected and ordering fields go through the sort
+    std::vector<std::string> orderFields = j.at("orderFields").get<std::vector<std::string> >();
+    std::vector<bool> ascendings = j.at("ascendings").get<std::vector<bool> >();
+    std::vector<int> fields, positions;
+    for (int64_t idx: selectedIdxes) {
+        positions.push_back(project(fields, static_cast<int>(idx)));
+    }
+    for (const auto &name: orderFields) {
+        project(fields, static_cast<int>(std::distance(fieldNames.begin(), std::ranges::find(fieldNames, name))));
+    }
+    auto records = scan(table, fields, matches);
+
+    {
+        Profiler::Scope scope("sort");
+        int workers = WorkerPool::agreedSize(j.at("workers").get<std::string>());
+        auto network = SortingNetwork::parse(j.at("sortNetwork").get<std::string>());
+        if (j.contains("limit")) {
+            // only the first records are revealed, which the top-k network finds for any sort mode
+            Order::topK(records, orderFields, ascendings, j.at("limit").get<int64_t>(), workers, network);
+        } else if (j.at("sortMode").get<std::string>() == "sequential") {
+            std::vector<BitSecret> ascs;
+            ascs.reserve(ascendings.size());
+
+            for (bool a: ascendings) {
+                ascs.emplace_back(a & Comm::rank());
             }
+            Order::bitonicSort(records, orderFields, ascs);
+        } else if (j.at("sortMode").get<std::string>() == "shuffle") {
+            Order::shuffleSort(records, orderFields, ascendings, workers);
+        } else if (j.at("sortMode").get<std::string>() == "key_only") {
+            Order::keySort(records, orderFields, ascendings, workers);
+        } else {
+            Order::sortBatched(records, orderFields, ascendings, workers, network);
         }
+    }
 
-        cur._valid.reconstruct();
+    // gather the output shares column by column
+    std::vector<Column> output;
+    for (size_t s = 0; s < selectedIdxes.size(); s++) {
+        output.emplace_back(table->fieldTypes()[selectedIdxes[s]]);
+        output.back().reserve(records.size());
+        for (const auto &r: records) {
+            output.back().append(static_cast<int64_t>(r.share(positions[s])));
+        }
+    }
+    output.emplace_back(1);
+    output.back().reserve(records.size());
+    for (const auto &r: records) {
+        output.back().append(r._valid.get());
     }
+    std::vector<const Column *> columns;
+    for (const auto &c: output) {
+        columns.push_back(&c);
+    }
+    std::vector<Column> compacted;
+    if (!matches.empty()) {
+        compact(j, columns, compacted);
+    }
+    Dealer::finish();
+
+    Profiler::Scope scope("reveal");
+    Reveal::send(columns, Channel());
 }
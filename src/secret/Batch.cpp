@@ -0,0 +1,396 @@
+#include "secret/Batch.h"
+
+#include <mpc_package/utils/Comm.h>
+
+#include "secret/Dealer.h"
+#include "secret/Profiler.h"
+
+size_t Batch::words(size_t n) {
+    return (n + 63) >> 6;
+}
+
+bool Batch::bit(const std::vector<uint64_t> &bits, size_t i) {
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+void Batch::setBit(std::vector<uint64_t> &bits, size_t i, bool v) {
+    if (v) {
+        bits[i >> 6] |= 1ULL << (i & 63);
+    } else {
+        bits[i >> 6] &= ~(1ULL << (i & 63));
+    }
+}
+
+std::vector<uint64_t> Batch::shift(const std::vector<uint64_t> &bits, size_t n, size_t d) {
+    std::vector<uint64_t> ret(bits.size());
+    for (size_t i = d; i < n; i++) {
+        setBit(ret, i, bit(bits, i - d));
+    }
+    return ret;
+}
+
+std::vector<uint64_t> Batch::not_(std::vector<uint64_t> x) {
+    if (Comm::rank() == 0) {
+        for (auto &w: x) {
+            w = ~w;
+        }
+    }
+    return x;
+}
+
+std::vector<uint64_t> Batch::and_(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                  const Channel &ch) {
+    size_t n = x.size();
+    Profiler::count(Profiler::AND, n * 64);
+    std::vector<uint64_t> a, b, c;
+    Dealer::andTriples(n, a, b, c, ch);
+
+    // open d = x ^ a and e = y ^ b
+    std::vector<uint64_t> masked(n * 2);
+    for (size_t i = 0; i < n; i++) {
+        masked[i] = x[i] ^ a[i];
+        masked[n + i] = y[i] ^ b[i];
+    }
+    auto other = ch.exchange(masked);
+
+    bool first = Comm::rank() == 0;
+    std::vector<uint64_t> z(n);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t d = masked[i] ^ other[i];
+        uint64_t e = masked[n + i] ^ other[n + i];
+        z[i] = c[i] ^ (d & b[i]) ^ (e & a[i]) ^ (first ? d & e : 0);
+    }
+    return z;
+}
+
+std::vector<uint64_t> Batch::mul(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                 const Channel &ch) {
+    size_t n = x.size();
+    std::vector<uint64_t> a, b, c;
+    Dealer::mulTriples(n, a, b, c, ch);
+
+    // open d = x - a and e = y - b
+    std::vector<uint64_t> masked(n * 2);
+    for (size_t i = 0; i < n; i++) {
+        masked[i] = x[i] - a[i];
+        masked[n + i] = y[i] - b[i];
+    }
+    auto other = ch.exchange(masked);
+
+    bool first = Comm::rank() == 0;
+    std::vector<uint64_t> z(n);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t d = masked[i] + other[i];
+        uint64_t e = masked[n + i] + other[n + i];
+        z[i] = c[i] + d * b[i] + e * a[i] + (first ? d * e : 0);
+    }
+    return z;
+}
+
+std::vector<uint64_t> Batch::toArith(const std::vector<uint64_t> &bits, size_t n, const Channel &ch) {
+    size_t w = words(n);
+    std::vector<uint64_t> r, rArith;
+    Dealer::randomBits(w, r, rArith, ch);
+
+    // open e = bits ^ r, then [b] = e + [r] - 2e[r]
+    std::vector<uint64_t> masked(w);
+    for (size_t i = 0; i < w; i++) {
+        masked[i] = bits[i] ^ r[i];
+    }
+    auto other = ch.exchange(masked);
+
+    bool first = Comm::rank() == 0;
+    std::vector<uint64_t> ret(n);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t e = ((masked[i >> 6] ^ other[i >> 6]) >> (i & 63)) & 1;
+        ret[i] = (first ? e : 0) + (1 - 2 * e) * rArith[i];
+    }
+    return ret;
+}
+
+std::vector<uint64_t> Batch::mux(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                 const std::vector<uint64_t> &cond, const Channel &ch) {
+    size_t n = x.size();
+    Profiler::count(Profiler::MUX, n);
+    auto c = toArith(cond, n, ch);
+    std::vector<uint64_t> diff(n);
+    for (size_t i = 0; i < n; i++) {
+        diff[i] = x[i] - y[i];
+    }
+    auto t = mul(c, diff, ch);
+    for (size_t i = 0; i < n; i++) {
+        t[i] += y[i];
+    }
+    return t;
+}
+
+size_t Batch::msbWords(int width, size_t n) {
+    size_t w = words(n);
+    size_t nodes = width - 1;
+    size_t total = nodes * w;
+    while (nodes > 1) {
+        total += (nodes / 2 * 2 - 1) * w;
+        nodes = (nodes + 1) / 2;
+    }
+    return total;
+}
+
+std::vector<uint64_t> Batch::msb(const std::vector<uint64_t> &x, int width, const Channel &ch) {
+    size_t n = x.size();
+    size_t w = words(n);
+    bool first = Comm::rank() == 0;
+    Dealer::reserve(Dealer::AND_TRIPLES, msbWords(width, n), ch);
+
+    // bit planes of this party's shares, plane i holds bit i of every value
+    std::vector<uint64_t> planes(width * w);
+    for (size_t l = 0; l < n; l++) {
+        for (int i = 0; i < width; i++) {
+            planes[i * w + (l >> 6)] |= ((x[l] >> i) & 1) << (l & 63);
+        }
+    }
+    // a single bit carries nothing into itself, the XOR of the shares is already the msb
+    if (width == 1) {
+        return planes;
+    }
+
+    // msb(x0 + x1) = msb(x0) ^ msb(x1) ^ carry into the top bit.
+    // Party 0 inputs x0 and party 1 inputs x1, so the propagate bit x0 ^ x1 of each position is
+    // already XOR shared and only the generate bit x0 & x1 needs an AND.
+    size_t nodes = width - 1;
+    std::vector<uint64_t> zeros(nodes * w);
+    std::vector<uint64_t> own(planes.begin(), planes.begin() + static_cast<int64_t>(nodes * w));
+    auto g = first ? and_(own, zeros, ch) : and_(zeros, own, ch);
+
+    // each node covers a range of positions and holds its (generate, propagate) pair
+    std::vector<std::vector<uint64_t> > G(nodes), P(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        G[i].assign(g.begin() + static_cast<int64_t>(i * w), g.begin() + static_cast<int64_t>((i + 1) * w));
+        P[i].assign(own.begin() + static_cast<int64_t>(i * w), own.begin() + static_cast<int64_t>((i + 1) * w));
+    }
+
+    // combine adjacent ranges until one covers all positions below the top bit.
+    // The lowest range never needs its propagate bit.
+    while (G.size() > 1) {
+        size_t pairs = G.size() / 2;
+        std::vector<uint64_t> lhs, rhs;
+        for (size_t k = 0; k < pairs; k++) {
+            lhs.insert(lhs.end(), P[2 * k + 1].begin(), P[2 * k + 1].end());
+            rhs.insert(rhs.end(), G[2 * k].begin(), G[2 * k].end());
+        }
+        for (size_t k = 1; k < pairs; k++) {
+            lhs.insert(lhs.end(), P[2 * k + 1].begin(), P[2 * k + 1].end());
+            rhs.insert(rhs.end(), P[2 * k].begin(), P[2 * k].end());
+        }
+        auto z = and_(lhs, rhs, ch);
+
+        std::vector<std::vector<uint64_t> > nextG, nextP;
+        for (size_t k = 0; k < pairs; k++) {
+            std::vector<uint64_t> gk = G[2 * k + 1];
+            for (size_t i = 0; i < w; i++) {
+                gk[i] ^= z[k * w + i];
+            }
+            nextG.push_back(std::move(gk));
+            if (k == 0) {
+                nextP.emplace_back();
+            } else {
+                size_t offset = (pairs + k - 1) * w;
+                nextP.emplace_back(z.begin() + static_cast<int64_t>(offset),
+                                   z.begin() + static_cast<int64_t>(offset + w));
+            }
+        }
+        if (G.size() % 2 == 1) {
+            nextG.push_back(std::move(G.back()));
+            nextP.push_back(std::move(P.back()));
+        }
+        G = std::move(nextG);
+        P = std::move(nextP);
+    }
+
+    std::vector<uint64_t> ret(planes.begin() + static_cast<int64_t>(nodes * w), planes.end());
+    for (size_t i = 0; i < w; i++) {
+        ret[i] ^= G[0][i];
+    }
+    return ret;
+}
+
+size_t Batch::lessThanWords(int width, size_t n) {
+    size_t w = words(n);
+    return msbWords(width, w * 64 * 3) + w;
+}
+
+std::vector<uint64_t> Batch::lessThan(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y, int width,
+                                      const Channel &ch) {
+    size_t n = x.size();
+    size_t w = words(n);
+    size_t segment = w * 64;
+    Profiler::count(Profiler::COMPARE, n);
+    Dealer::reserve(Dealer::AND_TRIPLES, lessThanWords(width, n), ch);
+
+    // msb of x, y and x - y in one pass, each segment aligned to whole words
+    std::vector<uint64_t> lanes(segment * 3);
+    for (size_t i = 0; i < n; i++) {
+        lanes[i] = x[i];
+        lanes[segment + i] = y[i];
+        lanes[segment * 2 + i] = x[i] - y[i];
+    }
+    auto s = msb(lanes, width, ch);
+
+    // x < y is msb(x - y) unless the signs differ, where it is msb(x):
+    // lt = sd ^ ((sx ^ sy) & (sx ^ sd))
+    std::vector<uint64_t> differ(w), choose(w);
+    for (size_t i = 0; i < w; i++) {
+        differ[i] = s[i] ^ s[w + i];
+        choose[i] = s[i] ^ s[w * 2 + i];
+    }
+    auto t = and_(differ, choose, ch);
+    for (size_t i = 0; i < w; i++) {
+        t[i] ^= s[w * 2 + i];
+    }
+    return t;
+}
+
+size_t Batch::compareWords(int width, size_t n) {
+    size_t w = words(n);
+    return msbWords(width, w * 64 * 4) + w * 2;
+}
+
+std::vector<uint64_t> Batch::compare(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y, int width,
+                                     const Channel &ch) {
+    size_t n = x.size();
+    size_t w = words(n);
+    size_t segment = w * 64;
+    bool first = Comm::rank() == 0;
+    Profiler::count(Profiler::COMPARE, n);
+    Dealer::reserve(Dealer::AND_TRIPLES, compareWords(width, n), ch);
+
+    // msb of x, y, d = x - y and d - 1 in one pass
+    std::vector<uint64_t> lanes(segment * 4);
+    for (size_t i = 0; i < n; i++) {
+        lanes[i] = x[i];
+        lanes[segment + i] = y[i];
+        lanes[segment * 2 + i] = x[i] - y[i];
+        lanes[segment * 3 + i] = x[i] - y[i] - (first ? 1 : 0);
+    }
+    auto s = msb(lanes, width, ch);
+
+    // lt as in lessThan(). d = 0 mod 2^width is the only d with msb(d) = 0 and msb(d - 1) = 1
+    std::vector<uint64_t> notD(s.begin() + static_cast<int64_t>(w * 2), s.begin() + static_cast<int64_t>(w * 3));
+    notD = not_(std::move(notD));
+    std::vector<uint64_t> lhs(w * 2), rhs(w * 2);
+    for (size_t i = 0; i < w; i++) {
+        lhs[i] = s[i] ^ s[w + i];
+        rhs[i] = s[i] ^ s[w * 2 + i];
+        lhs[w + i] = notD[i];
+        rhs[w + i] = s[w * 3 + i];
+    }
+    auto t = and_(lhs, rhs, ch);
+    for (size_t i = 0; i < w; i++) {
+        t[i] ^= s[w * 2 + i];
+    }
+    return t;
+}
+
+std::vector<uint64_t> Batch::equal(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y, int width,
+                                   const Channel &ch) {
+    size_t n = x.size();
+    size_t w = words(n);
+    bool first = Comm::rank() == 0;
+    Profiler::count(Profiler::EQUAL, n);
+
+    // x == y iff d0 == -d1 mod 2^width for d = x - y, so party 0 inputs d0 and party 1 inputs -d1.
+    // Their bits are XOR shares of the bits that differ, and equality is the AND of every equal bit.
+    std::vector<std::vector<uint64_t> > planes(width, std::vector<uint64_t>(w));
+    for (size_t l = 0; l < n; l++) {
+        uint64_t d = first ? x[l] - y[l] : y[l] - x[l];
+        for (int i = 0; i < width; i++) {
+            planes[i][l >> 6] |= ((d >> i) & 1) << (l & 63);
+        }
+    }
+    for (auto &p: planes) {
+        p = not_(std::move(p));
+    }
+
+    while (planes.size() > 1) {
+        size_t pairs = planes.size() / 2;
+        std::vector<uint64_t> lhs, rhs;
+        for (size_t k = 0; k < pairs; k++) {
+            lhs.insert(lhs.end(), planes[2 * k].begin(), planes[2 * k].end());
+            rhs.insert(rhs.end(), planes[2 * k + 1].begin(), planes[2 * k + 1].end());
+        }
+        auto z = and_(lhs, rhs, ch);
+
+        std::vector<std::vector<uint64_t> > next;
+        for (size_t k = 0; k < pairs; k++) {
+            next.emplace_back(z.begin() + static_cast<int64_t>(k * w), z.begin() + static_cast<int64_t>((k + 1) * w));
+        }
+        if (planes.size() % 2 == 1) {
+            next.push_back(std::move(planes.back()));
+        }
+        planes = std::move(next);
+    }
+    return planes[0];
+}
+
+std::vector<uint64_t> Batch::or_(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y,
+                                 const Channel &ch) {
+    auto z = and_(x, y, ch);
+    for (size_t i = 0; i < z.size(); i++) {
+        z[i] ^= x[i] ^ y[i];
+    }
+    return z;
+}
+
+std::vector<uint64_t> Batch::extend(const std::vector<uint64_t> &x, int width, const Channel &ch) {
+    if (width >= 64) {
+        return x;
+    }
+    size_t n = x.size();
+    bool first = Comm::rank() == 0;
+    uint64_t mask = (1ULL << width) - 1, bias = 1ULL << (width - 1);
+
+    // shares u0, u1 < 2^width of u = x + 2^(width - 1), which is never negative.
+    // In 64 bits u0 + u1 = u + 2^width * carry, and the carry is the msb of the (width + 1)-bit sum.
+    std::vector<uint64_t> u(n);
+    for (size_t i = 0; i < n; i++) {
+        u[i] = (x[i] + (first ? bias : 0)) & mask;
+    }
+    auto carry = toArith(msb(u, width + 1, ch), n, ch);
+    for (size_t i = 0; i < n; i++) {
+        u[i] -= (carry[i] << width) + (first ? bias : 0);
+    }
+    return u;
+}
+
+void Batch::shuffle(std::vector<uint64_t> &rows, size_t width, size_t ints, const Channel &ch) {
+    size_t n = width ? rows.size() / width : 0;
+    if (n < 2) {
+        return;
+    }
+    auto passes = Dealer::shuffle(n, width, ints, ch);
+    for (int p = 0; p < 2; p++) {
+        const auto &pass = passes[p];
+        if (p != Comm::rank()) {
+            // hand the masked shares to the permuting party and keep c as the new share
+            std::vector<uint64_t> z(rows.size());
+            for (size_t i = 0; i < rows.size(); i++) {
+                z[i] = i % width < ints ? rows[i] - pass.a[i] : rows[i] ^ pass.a[i];
+            }
+            ch.send(z, p);
+            rows = pass.c;
+            continue;
+        }
+        // row i takes row perm[i] of x + z, which holds the secret minus a, and adds perm(a) - c
+        auto z = ch.recv<uint64_t>(Channel::peer());
+        std::vector<uint64_t> permuted(rows.size());
+        for (size_t i = 0; i < n; i++) {
+            size_t from = pass.perm[i] * width;
+            for (size_t k = 0; k < width; k++) {
+                size_t to = i * width + k;
+                permuted[to] = k < ints
+                                   ? rows[from + k] + z[from + k] + pass.delta[to]
+                                   : rows[from + k] ^ z[from + k] ^ pass.delta[to];
+            }
+        }
+        rows = std::move(permuted);
+    }
+}
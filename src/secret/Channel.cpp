@@ -0,0 +1,195 @@
+#include "secret/Channel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <mpi.h>
+#include <mpc_package/utils/Comm.h>
+
+// MPI counts are ints, so a large buffer travels as full chunks closed by a shorter (maybe empty) one.
+// Smaller buffers are a single MPI message and never interleave with other senders on the same tag.
+static constexpr size_t CHUNK_BYTES = 1 << 28;
+
+// Without MPI_THREAD_MULTIPLE the threads of a WorkerPool take turns on MPI
+// and poll instead of blocking inside it.
+static bool serialized() {
+    static const bool s = [] {
+        int level;
+        MPI_Query_thread(&level);
+        return level < MPI_THREAD_MULTIPLE;
+    }();
+    return s;
+}
+
+static std::mutex mpiMutex;
+
+struct Counters {
+    std::atomic<uint64_t> bytes, messages, rounds;
+};
+
+// every channel, then the query channels of each slot
+static Counters all, slots[Channel::MAX_SLOTS];
+
+// counters of the query slot `tag` belongs to, null for the control channels and those below DEALER_TAG
+static Counters *slotOf(int tag) {
+    int base = tag % Channel::SLOT_TAGS;
+    bool query = base == Channel::DEALER_TAG || base == Channel::DEFAULT_TAG || base >= Channel::WORKER_TAG;
+    return query ? &slots[tag / Channel::SLOT_TAGS] : nullptr;
+}
+
+static void wait(std::vector<MPI_Request> &requests) {
+    if (!serialized()) {
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        return;
+    }
+    while (true) {
+        int done;
+        {
+            std::lock_guard lock(mpiMutex);
+            MPI_Testall(static_cast<int>(requests.size()), requests.data(), &done, MPI_STATUSES_IGNORE);
+        }
+        if (done) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+static void probe(int senderRank, int tag, MPI_Status *status) {
+    if (!serialized()) {
+        MPI_Probe(senderRank, tag, MPI_COMM_WORLD, status);
+        return;
+    }
+    while (true) {
+        int found;
+        {
+            std::lock_guard lock(mpiMutex);
+            MPI_Iprobe(senderRank, tag, MPI_COMM_WORLD, &found, status);
+        }
+        if (found) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+static std::vector<MPI_Request> post(const void *data, size_t bytes, int receiverRank, int tag) {
+    std::unique_lock lock(mpiMutex, std::defer_lock);
+    if (serialized()) {
+        lock.lock();
+    }
+    std::vector<MPI_Request> requests;
+    Counters *slot = slotOf(tag);
+    all.bytes += bytes;
+    if (slot) {
+        slot->bytes += bytes;
+    }
+    const auto *p = static_cast<const uint8_t *>(data);
+    size_t offset = 0;
+    while (true) {
+        size_t count = std::min(CHUNK_BYTES, bytes - offset);
+        MPI_Request r;
+        MPI_Isend(p + offset, static_cast<int>(count), MPI_BYTE, receiverRank, tag, MPI_COMM_WORLD, &r);
+        requests.push_back(r);
+        all.messages++;
+        if (slot) {
+            slot->messages++;
+        }
+        offset += count;
+        if (count < CHUNK_BYTES) {
+            return requests;
+        }
+    }
+}
+
+static void receive(int senderRank, int tag, const std::function<void *(size_t)> &allocate) {
+    Counters *slot = slotOf(tag);
+    all.rounds++;
+    if (slot) {
+        slot->rounds++;
+    }
+    size_t offset = 0;
+    while (true) {
+        MPI_Status status;
+        int count;
+        probe(senderRank, tag, &status);
+        MPI_Get_count(&status, MPI_BYTE, &count);
+        auto *p = static_cast<uint8_t *>(allocate(offset + count));
+        {
+            // the message has arrived, so this receive does not block other threads for long
+            std::unique_lock lock(mpiMutex, std::defer_lock);
+            if (serialized()) {
+                lock.lock();
+            }
+            MPI_Recv(p + offset, count, MPI_BYTE, senderRank, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        offset += count;
+        if (count < CHUNK_BYTES) {
+            return;
+        }
+    }
+}
+
+thread_local int Channel::_slot = 0;
+
+Channel::Channel(int tag) {
+    bool query = tag == DEALER_TAG || tag == DEFAULT_TAG || tag >= WORKER_TAG;
+    this->_tag = query ? tag + _slot * SLOT_TAGS : tag;
+}
+
+Channel Channel::exact(int tag) {
+    Channel ch;
+    ch._tag = tag;
+    return ch;
+}
+
+int Channel::tag() const {
+    return _tag;
+}
+
+void Channel::bind(int slot) {
+    _slot = slot;
+}
+
+int Channel::slot() {
+    return _slot;
+}
+
+int Channel::peer() {
+    return 1 - Comm::rank();
+}
+
+Channel::Traffic Channel::traffic() {
+    return {all.bytes, all.messages, all.rounds};
+}
+
+Channel::Traffic Channel::traffic(int slot) {
+    return {slots[slot].bytes, slots[slot].messages, slots[slot].rounds};
+}
+
+bool Channel::pending(int senderRank) const {
+    std::unique_lock lock(mpiMutex, std::defer_lock);
+    if (serialized()) {
+        lock.lock();
+    }
+    int found;
+    MPI_Iprobe(senderRank, _tag, MPI_COMM_WORLD, &found, MPI_STATUS_IGNORE);
+    return found;
+}
+
+void Channel::sendBytes(const void *data, size_t bytes, int receiverRank) const {
+    auto requests = post(data, bytes, receiverRank, _tag);
+    wait(requests);
+}
+
+void Channel::recvBytes(int senderRank, const std::function<void *(size_t)> &allocate) const {
+    receive(senderRank, _tag, allocate);
+}
+
+void Channel::exchangeBytes(const void *data, size_t bytes, const std::function<void *(size_t)> &allocate) const {
+    // post our side first so that both parties can receive without waiting for each other
+    auto requests = post(data, bytes, peer(), _tag);
+    receive(peer(), _tag, allocate);
+    wait(requests);
+}
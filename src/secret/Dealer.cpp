@@ -0,0 +1,327 @@
+#include "secret/Dealer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <mpc_package/utils/Comm.h>
+
+// words per unit in the a / b / c parts of each kind
+struct Layout {
+    size_t a, b, c;
+};
+
+static Layout layoutOf(Dealer::Kind kind) {
+    if (kind == Dealer::RANDOM_BITS) {
+        return {1, 64, 0};
+    }
+    return {1, 1, 1};
+}
+
+struct Stock {
+    Layout _layout{};
+    std::vector<uint64_t> _a, _b, _c;
+    // consumed units
+    size_t _pos{};
+
+    [[nodiscard]] size_t available() const {
+        return _a.size() / _layout.a - _pos;
+    }
+
+    // append a dealt message laid out as [a parts][b parts][c parts]
+    void add(const std::vector<uint64_t> &msg) {
+        size_t units = msg.size() / (_layout.a + _layout.b + _layout.c);
+        auto it = msg.begin();
+        _a.insert(_a.end(), it, it + static_cast<int64_t>(units * _layout.a));
+        it += static_cast<int64_t>(units * _layout.a);
+        _b.insert(_b.end(), it, it + static_cast<int64_t>(units * _layout.b));
+        it += static_cast<int64_t>(units * _layout.b);
+        _c.insert(_c.end(), it, msg.end());
+    }
+
+    void take(size_t n, std::vector<uint64_t> &a, std::vector<uint64_t> &b, std::vector<uint64_t> &c) {
+        a.assign(_a.begin() + static_cast<int64_t>(_pos * _layout.a),
+                 _a.begin() + static_cast<int64_t>((_pos + n) * _layout.a));
+        b.assign(_b.begin() + static_cast<int64_t>(_pos * _layout.b),
+                 _b.begin() + static_cast<int64_t>((_pos + n) * _layout.b));
+        c.assign(_c.begin() + static_cast<int64_t>(_pos * _layout.c),
+                 _c.begin() + static_cast<int64_t>((_pos + n) * _layout.c));
+        _pos += n;
+
+        // drop the consumed prefix once it dominates the stock
+        if (_pos * 2 > _a.size() / _layout.a) {
+            _a.erase(_a.begin(), _a.begin() + static_cast<int64_t>(_pos * _layout.a));
+            _b.erase(_b.begin(), _b.begin() + static_cast<int64_t>(_pos * _layout.b));
+            _c.erase(_c.begin(), _c.begin() + static_cast<int64_t>(_pos * _layout.c));
+            _pos = 0;
+        }
+    }
+};
+
+static std::mutex stocksMutex;
+static std::map<std::pair<int, Dealer::Kind>, Stock> stocks;
+
+static Stock &stockOf(Dealer::Kind kind, const Channel &ch) {
+    std::lock_guard lock(stocksMutex);
+    auto &stock = stocks[{ch.tag(), kind}];
+    stock._layout = layoutOf(kind);
+    return stock;
+}
+
+static std::mt19937_64 &engine() {
+    static thread_local std::mt19937_64 e(std::random_device{}());
+    return e;
+}
+
+// `count` units of `kind`, the message of each computing party laid out as [a parts][b parts][c parts]
+static void generate(Dealer::Kind kind, size_t count, std::vector<uint64_t> &s0, std::vector<uint64_t> &s1) {
+    auto &rand = engine();
+    Layout l = layoutOf(kind);
+    size_t size = count * (l.a + l.b + l.c);
+    s0.assign(size, 0);
+    s1.assign(size, 0);
+    uint64_t *a0 = s0.data(), *b0 = a0 + count * l.a, *c0 = b0 + count * l.b;
+    uint64_t *a1 = s1.data(), *b1 = a1 + count * l.a, *c1 = b1 + count * l.b;
+
+    for (size_t i = 0; i < count; i++) {
+        switch (kind) {
+            case Dealer::AND_TRIPLES: {
+                uint64_t a = rand(), b = rand(), c = a & b;
+                a0[i] = rand(), b0[i] = rand(), c0[i] = rand();
+                a1[i] = a ^ a0[i], b1[i] = b ^ b0[i], c1[i] = c ^ c0[i];
+                break;
+            }
+            case Dealer::MUL_TRIPLES: {
+                uint64_t a = rand(), b = rand(), c = a * b;
+                a0[i] = rand(), b0[i] = rand(), c0[i] = rand();
+                a1[i] = a - a0[i], b1[i] = b - b0[i], c1[i] = c - c0[i];
+                break;
+            }
+            default: {
+                uint64_t word = rand();
+                a0[i] = rand();
+                a1[i] = word ^ a0[i];
+                for (int k = 0; k < 64; k++) {
+                    b0[i * 64 + k] = rand();
+                    b1[i * 64 + k] = ((word >> k) & 1) - b0[i * 64 + k];
+                }
+                break;
+            }
+        }
+    }
+}
+
+// client: units generated before they are requested, one stock per computing party and kind
+struct Pool {
+    // units kept ready per kind, about 50 MB for the triples and 17 MB for the random bits
+    static constexpr size_t TARGET[] = {0, 1 << 20, 1 << 20, 1 << 14};
+
+    std::mutex _mutex;
+    std::condition_variable_any _consumed;
+    std::map<Dealer::Kind, Stock> _stocks[2];
+    std::jthread _thread;
+
+    Stock &stock(int party, Dealer::Kind kind) {
+        auto &s = _stocks[party][kind];
+        s._layout = layoutOf(kind);
+        return s;
+    }
+
+    // keep every kind at its target while the client is idle
+    void fill(const std::stop_token &stop) {
+        static constexpr Dealer::Kind kinds[] = {Dealer::AND_TRIPLES, Dealer::MUL_TRIPLES, Dealer::RANDOM_BITS};
+        while (true) {
+            Dealer::Kind low = Dealer::END;
+            {
+                std::unique_lock lock(_mutex);
+                bool found = _consumed.wait(lock, stop, [&] {
+                    for (auto k: kinds) {
+                        if (stock(0, k).available() < TARGET[k]) {
+                            low = k;
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (!found) {
+                    return;
+                }
+            }
+            std::vector<uint64_t> s0, s1;
+            generate(low, Dealer::MIN_FETCH, s0, s1);
+            std::lock_guard lock(_mutex);
+            stock(0, low).add(s0);
+            stock(1, low).add(s1);
+        }
+    }
+
+    // take `count` units, generating what the background thread has not
+    void take(Dealer::Kind kind, size_t count, std::vector<uint64_t> &s0, std::vector<uint64_t> &s1) {
+        std::lock_guard lock(_mutex);
+        size_t ready = stock(0, kind).available();
+        if (ready < count) {
+            generate(kind, count - ready, s0, s1);
+            stock(0, kind).add(s0);
+            stock(1, kind).add(s1);
+        }
+        std::vector<uint64_t> *out[] = {&s0, &s1};
+        for (int p = 0; p < 2; p++) {
+            std::vector<uint64_t> a, b, c;
+            stock(p, kind).take(count, a, b, c);
+            out[p]->assign(a.begin(), a.end());
+            out[p]->insert(out[p]->end(), b.begin(), b.end());
+            out[p]->insert(out[p]->end(), c.begin(), c.end());
+        }
+        _consumed.notify_one();
+    }
+};
+
+static Pool pool;
+
+// send each computing party its shares of `count` units of `kind`
+static void deal(Dealer::Kind kind, size_t count, int tag) {
+    std::vector<uint64_t> s0, s1;
+    pool.take(kind, count, s0, s1);
+
+    // the tag of a request already belongs to the slot of the operator
+    Channel ch = Channel::exact(tag);
+    ch.send(s0, 0);
+    ch.send(s1, 1);
+}
+
+// send each computing party its side of both passes of a shuffle
+static void dealShuffle(size_t n, size_t width, size_t ints, int tag) {
+    auto &rand = engine();
+    size_t words = n * width;
+    std::vector<uint64_t> msgs[2];
+    for (int p = 0; p < 2; p++) {
+        std::vector<uint64_t> perm(n), a(words), c(words), delta(words);
+        std::iota(perm.begin(), perm.end(), 0);
+        std::ranges::shuffle(perm, rand);
+        std::ranges::generate(a, std::ref(rand));
+        std::ranges::generate(c, std::ref(rand));
+        for (size_t i = 0; i < n; i++) {
+            for (size_t k = 0; k < width; k++) {
+                uint64_t x = a[perm[i] * width + k];
+                delta[i * width + k] = k < ints ? x - c[i * width + k] : x ^ c[i * width + k];
+            }
+        }
+        // the permuting party gets [perm][delta], the other [a][c]
+        auto &mine = msgs[p];
+        mine.insert(mine.end(), perm.begin(), perm.end());
+        mine.insert(mine.end(), delta.begin(), delta.end());
+        auto &other = msgs[1 - p];
+        other.insert(other.end(), a.begin(), a.end());
+        other.insert(other.end(), c.begin(), c.end());
+    }
+
+    Channel ch = Channel::exact(tag);
+    ch.send(msgs[0], 0);
+    ch.send(msgs[1], 1);
+}
+
+void Dealer::startPool() {
+    std::lock_guard lock(pool._mutex);
+    if (!pool._thread.joinable()) {
+        pool._thread = std::jthread([](const std::stop_token &stop) {
+            pool.fill(stop);
+        });
+    }
+}
+
+size_t Dealer::available(Kind kind, const Channel &ch) {
+    return stockOf(kind, ch).available();
+}
+
+size_t Dealer::stocked(Kind kind, int slot) {
+    std::lock_guard lock(stocksMutex);
+    size_t ret = 0;
+    for (const auto &[key, stock]: stocks) {
+        if (key.second == kind && key.first / Channel::SLOT_TAGS == slot) {
+            ret += stock.available();
+        }
+    }
+    return ret;
+}
+
+void Dealer::serve() {
+    Channel requests(Channel::DEALER_TAG);
+    while (true) {
+        auto req = requests.recv<uint64_t>(0);
+        auto kind = static_cast<Kind>(req[0]);
+        if (kind == END) {
+            return;
+        }
+        if (kind == SHUFFLE) {
+            dealShuffle(req[1], req[3], req[4], static_cast<int>(req[2]));
+            continue;
+        }
+        deal(kind, req[1], static_cast<int>(req[2]));
+    }
+}
+
+void Dealer::finish() {
+    if (Comm::rank() == 0) {
+        std::vector<uint64_t> req = {END, 0, 0};
+        Channel(Channel::DEALER_TAG).send(req, Comm::CLIENT_RANK);
+    }
+}
+
+void Dealer::reserve(Kind kind, size_t count, const Channel &ch) {
+    Stock &stock = stockOf(kind, ch);
+    if (stock.available() >= count) {
+        return;
+    }
+    size_t fetch = std::max(count - stock.available(), MIN_FETCH);
+    if (Comm::rank() == 0) {
+        std::vector<uint64_t> req = {kind, fetch, static_cast<uint64_t>(ch.tag())};
+        Channel(Channel::DEALER_TAG).send(req, Comm::CLIENT_RANK);
+    }
+    stock.add(ch.recv<uint64_t>(Comm::CLIENT_RANK));
+}
+
+void Dealer::andTriples(size_t words, std::vector<uint64_t> &a, std::vector<uint64_t> &b, std::vector<uint64_t> &c,
+                        const Channel &ch) {
+    reserve(AND_TRIPLES, words, ch);
+    stockOf(AND_TRIPLES, ch).take(words, a, b, c);
+}
+
+void Dealer::mulTriples(size_t n, std::vector<uint64_t> &a, std::vector<uint64_t> &b, std::vector<uint64_t> &c,
+                        const Channel &ch) {
+    reserve(MUL_TRIPLES, n, ch);
+    stockOf(MUL_TRIPLES, ch).take(n, a, b, c);
+}
+
+std::vector<Dealer::Pass> Dealer::shuffle(size_t n, size_t width, size_t ints, const Channel &ch) {
+    if (Comm::rank() == 0) {
+        std::vector<uint64_t> req = {SHUFFLE, n, static_cast<uint64_t>(ch.tag()), width, ints};
+        Channel(Channel::DEALER_TAG).send(req, Comm::CLIENT_RANK);
+    }
+    auto msg = ch.recv<uint64_t>(Comm::CLIENT_RANK);
+    std::vector<Pass> ret(2);
+    auto it = msg.begin();
+    auto next = [&it](std::vector<uint64_t> &v, size_t size) {
+        v.assign(it, it + static_cast<int64_t>(size));
+        it += static_cast<int64_t>(size);
+    };
+    for (int p = 0; p < 2; p++) {
+        if (p == Comm::rank()) {
+            next(ret[p].perm, n);
+            next(ret[p].delta, n * width);
+        } else {
+            next(ret[p].a, n * width);
+            next(ret[p].c, n * width);
+        }
+    }
+    return ret;
+}
+
+void Dealer::randomBits(size_t words, std::vector<uint64_t> &bits, std::vector<uint64_t> &arith,
+                        const Channel &ch) {
+    std::vector<uint64_t> unused;
+    reserve(RANDOM_BITS, words, ch);
+    stockOf(RANDOM_BITS, ch).take(words, bits, arith, unused);
+}
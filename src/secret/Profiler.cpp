@@ -0,0 +1,86 @@
+#include "secret/Profiler.h"
+
+#include <mpc_package/utils/System.h>
+
+std::atomic<uint64_t> Profiler::_ops[Channel::MAX_SLOTS][OPS];
+std::mutex Profiler::_mutex;
+std::vector<std::pair<std::string, Profiler::Cost> > Profiler::_last[Channel::MAX_SLOTS];
+std::map<std::string, Profiler::Cost> Profiler::_totals;
+
+Profiler::Scope::Scope(std::string name) {
+    this->_name = std::move(name);
+    this->_start = now();
+}
+
+Profiler::Scope::~Scope() {
+    Cost end = now();
+    Cost cost{1, end.ms - _start.ms, end.rounds - _start.rounds, end.bytes - _start.bytes,
+              end.messages - _start.messages, {}};
+    for (int i = 0; i < OPS; i++) {
+        cost.ops[i] = end.ops[i] - _start.ops[i];
+    }
+
+    std::lock_guard lock(_mutex);
+    _last[Channel::slot()].emplace_back(_name, cost);
+    Cost &total = _totals[_name];
+    total.calls += cost.calls;
+    total.ms += cost.ms;
+    total.rounds += cost.rounds;
+    total.bytes += cost.bytes;
+    total.messages += cost.messages;
+    for (int i = 0; i < OPS; i++) {
+        total.ops[i] += cost.ops[i];
+    }
+}
+
+void Profiler::count(Op op, uint64_t n) {
+    _ops[Channel::slot()][op] += n;
+}
+
+void Profiler::beginCommand() {
+    std::lock_guard lock(_mutex);
+    _last[Channel::slot()].clear();
+}
+
+nlohmann::json Profiler::last() {
+    std::lock_guard lock(_mutex);
+    auto ret = nlohmann::json::array();
+    for (const auto &[name, cost]: _last[Channel::slot()]) {
+        ret.push_back(toJson(name, cost));
+    }
+    return ret;
+}
+
+nlohmann::json Profiler::totals() {
+    std::lock_guard lock(_mutex);
+    auto ret = nlohmann::json::array();
+    for (const auto &[name, cost]: _totals) {
+        ret.push_back(toJson(name, cost));
+    }
+    return ret;
+}
+
+Profiler::Cost Profiler::now() {
+    int slot = Channel::slot();
+    auto t = Channel::traffic(slot);
+    Cost c{0, System::currentTimeMillis(), t.rounds, t.bytes, t.messages, {}};
+    for (int i = 0; i < OPS; i++) {
+        c.ops[i] = _ops[slot][i];
+    }
+    return c;
+}
+
+nlohmann::json Profiler::toJson(const std::string &name, const Cost &cost) {
+    nlohmann::json j;
+    j["operator"] = name;
+    j["calls"] = cost.calls;
+    j["ms"] = cost.ms;
+    j["rounds"] = cost.rounds;
+    j["bytes"] = cost.bytes;
+    j["messages"] = cost.messages;
+    j["compare"] = cost.ops[COMPARE];
+    j["equal"] = cost.ops[EQUAL];
+    j["mux"] = cost.ops[MUX];
+    j["and"] = cost.ops[AND];
+    return j;
+}
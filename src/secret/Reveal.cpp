@@ -0,0 +1,60 @@
+#include "secret/Reveal.h"
+
+#include <mpc_package/utils/Comm.h>
+
+void Reveal::send(const std::vector<const Column *> &columns, const Channel &ch) {
+    ch.send(Column::pack(columns), Comm::CLIENT_RANK);
+}
+
+void Reveal::fail(const Channel &ch) {
+    // a packed buffer holds at least its row count
+    ch.send(std::vector<uint8_t>(), Comm::CLIENT_RANK);
+}
+
+template<typename T>
+void reconstructT(const Column &s0, const Column &s1, std::vector<int64_t> &out) {
+    auto v0 = s0.view<T>();
+    auto v1 = s1.view<T>();
+    for (size_t i = 0; i < out.size(); i++) {
+        // wraps modulo 2^width
+        out[i] = static_cast<T>(static_cast<uint64_t>(v0[i]) + static_cast<uint64_t>(v1[i]));
+    }
+}
+
+std::vector<std::vector<int64_t> > Reveal::recv(const std::vector<int> &types, const Channel &ch) {
+    auto b0 = ch.recv<uint8_t>(0);
+    auto b1 = ch.recv<uint8_t>(1);
+    if (b0.empty() || b1.empty()) {
+        return {};
+    }
+    auto s0 = Column::unpack(b0, types);
+    auto s1 = Column::unpack(b1, types);
+    size_t rows = s0.empty() ? 0 : s0[0].size();
+
+    std::vector<std::vector<int64_t> > values(types.size(), std::vector<int64_t>(rows));
+    for (size_t c = 0; c < types.size(); c++) {
+        auto &out = values[c];
+        switch (types[c]) {
+            case 1: {
+                const uint64_t *w0 = s0[c].bits().words(), *w1 = s1[c].bits().words();
+                for (size_t i = 0; i < rows; i++) {
+                    out[i] = ((w0[i >> 6] ^ w1[i >> 6]) >> (i & 63)) & 1;
+                }
+                break;
+            }
+            case 8:
+                reconstructT<int8_t>(s0[c], s1[c], out);
+                break;
+            case 16:
+                reconstructT<int16_t>(s0[c], s1[c], out);
+                break;
+            case 32:
+                reconstructT<int32_t>(s0[c], s1[c], out);
+                break;
+            default:
+                reconstructT<int64_t>(s0[c], s1[c], out);
+                break;
+        }
+    }
+    return values;
+}
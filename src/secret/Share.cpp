@@ -0,0 +1,40 @@
+#include "secret/Share.h"
+
+#include <random>
+#include <mpc_package/utils/Comm.h>
+
+static std::mt19937_64 &engine() {
+    static std::mt19937_64 e(std::random_device{}());
+    return e;
+}
+
+void Share::send(const std::vector<std::vector<int64_t> > &values, const std::vector<int> &types,
+                 const Channel &ch) {
+    auto &rand = engine();
+    std::vector<Column> shares[2];
+    for (size_t c = 0; c < types.size(); c++) {
+        Column s0(types[c]), s1(types[c]);
+        s0.reserve(values[c].size());
+        s1.reserve(values[c].size());
+        for (int64_t v: values[c]) {
+            auto r = static_cast<int64_t>(rand());
+            s0.append(r);
+            // columns keep the low `width` bits, so both forms wrap correctly
+            s1.append(types[c] == 1 ? v ^ r : static_cast<int64_t>(static_cast<uint64_t>(v) - r));
+        }
+        shares[0].push_back(std::move(s0));
+        shares[1].push_back(std::move(s1));
+    }
+
+    for (int p = 0; p < 2; p++) {
+        std::vector<const Column *> columns;
+        for (const auto &c: shares[p]) {
+            columns.push_back(&c);
+        }
+        ch.send(Column::pack(columns), p);
+    }
+}
+
+std::vector<Column> Share::recv(const std::vector<int> &types, const Channel &ch) {
+    return Column::unpack(ch.recv<uint8_t>(Comm::CLIENT_RANK), types);
+}
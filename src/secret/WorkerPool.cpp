@@ -0,0 +1,83 @@
+#include "secret/WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int workers) {
+    this->_slot = Channel::slot();
+    workers = std::clamp(workers, 1, MAX_WORKERS);
+    for (int i = 0; i < workers; i++) {
+        _channels.emplace_back(Channel::WORKER_TAG + i);
+    }
+    for (int i = 1; i < workers; i++) {
+        _threads.emplace_back(&WorkerPool::loop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+    for (auto &t: _threads) {
+        t.join();
+    }
+}
+
+int WorkerPool::size() const {
+    return static_cast<int>(_channels.size());
+}
+
+void WorkerPool::run(const std::function<void(int, const Channel &)> &job) {
+    {
+        std::lock_guard lock(_mutex);
+        _job = job;
+        _running = static_cast<int>(_threads.size());
+        _generation++;
+    }
+    _start.notify_all();
+
+    job(0, _channels[0]);
+
+    std::unique_lock lock(_mutex);
+    _finish.wait(lock, [this] { return _running == 0; });
+}
+
+void WorkerPool::loop(int worker) {
+    // randomness requests of a worker go to the dealer channel of its slot
+    Channel::bind(_slot);
+    uint64_t seen = 0;
+    while (true) {
+        std::function<void(int, const Channel &)> job;
+        {
+            std::unique_lock lock(_mutex);
+            _start.wait(lock, [this, seen] { return _stop || _generation != seen; });
+            if (_stop) {
+                return;
+            }
+            seen = _generation;
+            job = _job;
+        }
+
+        job(worker, _channels[worker]);
+
+        {
+            std::lock_guard lock(_mutex);
+            _running--;
+        }
+        _finish.notify_one();
+    }
+}
+
+int WorkerPool::agreedSize(int requested) {
+    if (requested > 0) {
+        return std::min(requested, MAX_WORKERS);
+    }
+    std::vector<uint64_t> cores = {std::max(1u, std::thread::hardware_concurrency())};
+    auto other = Channel().exchange(cores);
+    return static_cast<int>(std::min<uint64_t>({cores[0], other[0], MAX_WORKERS}));
+}
+
+int WorkerPool::agreedSize(const std::string &setting) {
+    return agreedSize(setting == "auto" ? 0 : std::stoi(setting));
+}
@@ -5,24 +5,54 @@
 #include "socket/LocalServer.h"
 #include <iostream>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <unistd.h>
-#include <nlohmann/json.hpp>
 #include "dbms/SystemManager.h"
-using json = nlohmann::json;
 
-LocalServer::LocalServer() : server_fd(-1), new_socket(-1) {
+// epoll data of the listening socket and of the wakeup event, connections use their id
+static constexpr uint64_t LISTEN_ID = 0;
+static constexpr uint64_t EVENT_ID = UINT64_MAX;
+
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// block until the socket `fd` took every byte of `out`, or failed
+static void flush(int fd, std::string &out) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    while (!out.empty()) {
+        ssize_t n = send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            return;
+        }
+        out.erase(0, n);
+    }
+}
+
+static std::string frame(const std::string &msg) {
+    uint32_t length = htonl(static_cast<uint32_t>(msg.size()));
+    std::string ret(reinterpret_cast<const char *>(&length), sizeof(length));
+    return ret + msg;
+}
+
+LocalServer::LocalServer() {
     setupServer();
 }
 
 LocalServer::~LocalServer() {
     if (server_fd != -1) close(server_fd);
+    if (epoll_fd != -1) close(epoll_fd);
+    if (event_fd != -1) close(event_fd);
 }
 
 void LocalServer::setupServer() {
     // Create socket file descriptor
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
         perror("Socket creation failed");
         exit(EXIT_FAILURE);
     }
@@ -36,6 +66,7 @@ void LocalServer::setupServer() {
     }
 
     // Configure server address struct
+    struct sockaddr_in address{};
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(PORT);
@@ -48,73 +79,200 @@ void LocalServer::setupServer() {
     }
 
     // Start listening for incoming connections
-    if (listen(server_fd, 3) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0) {
         perror("Listen failed");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
+    setNonBlocking(server_fd);
+
+    epoll_fd = epoll_create1(0);
+    event_fd = eventfd(0, EFD_NONBLOCK);
+    if (epoll_fd < 0 || event_fd < 0) {
+        perror("epoll setup failed");
+        exit(EXIT_FAILURE);
+    }
+    watch(server_fd, LISTEN_ID, false, true);
+    watch(event_fd, EVENT_ID, false, true);
 
     std::cout << "Server is listening on port " << PORT << std::endl;
 }
 
-void LocalServer::run() {
-    while (true) {
-        // Wait for a new client connection
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen)) < 0) {
-            perror("Accept failed");
-            return;
-        }
+void LocalServer::watch(int fd, uint64_t id, bool writing, bool add, bool reading) {
+    epoll_event ev{};
+    ev.events = (reading ? EPOLLIN : 0) | (writing ? EPOLLOUT : 0);
+    ev.data.u64 = id;
+    epoll_ctl(epoll_fd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+}
 
-        while (true) {
-            std::string command;
-            char buffer[BUFFER_SIZE] = {0};
-            int64_t valread;
+void LocalServer::run(int limit) {
+    _scheduler = std::make_unique<Scheduler>(limit);
+    loop();
+}
 
-            // Receive message in chunks
-            while ((valread = read(new_socket, buffer, BUFFER_SIZE)) > 0) {
-                // Append the chunk to the command string
-                command.append(buffer, valread);
+void LocalServer::send_(uint64_t connection, std::string msg) {
+    {
+        std::lock_guard lock(_mutex);
+        _responses.emplace_back(connection, frame(msg));
+    }
+    uint64_t one = 1;
+    write(event_fd, &one, sizeof(one));
+}
 
-                // If the received data is less than BUFFER_SIZE, assume the end of the message
-                if (valread < BUFFER_SIZE) {
-                    break;
+void LocalServer::loop() {
+    epoll_event events[64];
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, 64, -1);
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                accept_();
+                continue;
+            }
+            if (id == EVENT_ID) {
+                uint64_t count;
+                read(event_fd, &count, sizeof(count));
+                std::deque<std::pair<uint64_t, std::string> > responses;
+                {
+                    std::lock_guard lock(_mutex);
+                    responses.swap(_responses);
+                }
+                for (auto &[connection, msg]: responses) {
+                    auto it = _connections.find(connection);
+                    if (it != _connections.end()) {
+                        it->second.out += msg;
+                        it->second.pending--;
+                        if (!write_(connection, it->second)) {
+                            close_(connection);
+                        }
+                    }
+                }
+                if (_stopped) {
+                    // nothing answers once this returns, so what is left of the responses goes out now
+                    for (auto &[connection, c]: _connections) {
+                        flush(c.fd, c.out);
+                    }
+                    return;
                 }
+                continue;
             }
 
-            if (valread <= 0) {
-                // Client disconnected or an error occurred
-                break;
+            auto it = _connections.find(id);
+            if (it == _connections.end()) {
+                continue;
             }
-
-            // Check if the command is "exit" (case-insensitive)
-            if (strcasecmp(command.c_str(), "exit") == 0) {
-                json j;
-                j["type"] = "exit";
-                SystemManager::notifyServersSync(j);
-                break;
+            bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if (alive && (events[i].events & EPOLLIN)) {
+                alive = read_(id, it->second);
+            }
+            if (alive && (events[i].events & EPOLLOUT)) {
+                alive = write_(id, it->second);
+            }
+            if (!alive) {
+                close_(id);
             }
+        }
+    }
+}
+
+void LocalServer::accept_() {
+    while (true) {
+        int fd = accept(server_fd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        setNonBlocking(fd);
+        uint64_t id = _nextConnection++;
+        _connections[id] = Connection{fd, "", "", 0, false, std::make_shared<Session>()};
+        watch(fd, id, false, true);
+    }
+}
+
+bool LocalServer::read_(uint64_t id, Connection &c) {
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t n = read(c.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            c.in.append(buffer, n);
+            continue;
+        }
+        if (n == 0) {
+            c.eof = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        break;
+    }
 
-            // Process the complete command
-            SystemManager::getInstance().clientExecute(command);
+    // queue every complete frame
+    size_t offset = 0;
+    while (c.in.size() - offset >= sizeof(uint32_t)) {
+        uint32_t length;
+        std::memcpy(&length, c.in.data() + offset, sizeof(length));
+        length = ntohl(length);
+        if (length > MAX_FRAME) {
+            return false;
+        }
+        if (c.in.size() - offset - sizeof(uint32_t) < length) {
+            break;
         }
+        std::string command = c.in.substr(offset + sizeof(uint32_t), length);
+        offset += sizeof(uint32_t) + length;
 
-        // Close the socket for the current client, allowing the server to accept a new connection
-        close(new_socket);
+        // "exit" closes this connection once the commands before it are answered, as the end of its input does.
+        // "shutdown" stops the computing parties and the client.
+        if (strcasecmp(command.c_str(), "exit") == 0 || strcasecmp(command.c_str(), "exit;") == 0) {
+            c.eof = true;
+            offset = c.in.size();
+            break;
+        }
+        bool shutdown = strcasecmp(command.c_str(), "shutdown") == 0 || strcasecmp(command.c_str(), "shutdown;") == 0;
+        c.pending++;
+        _scheduler->submit(id, c.session, std::move(command), [this, id, shutdown](std::string response) {
+            if (shutdown) {
+                _stopped = true;
+            }
+            send_(id, std::move(response));
+        });
     }
+    c.in.erase(0, offset);
+    if (c.eof) {
+        if (c.pending == 0 && c.out.empty()) {
+            return false;
+        }
+        watch(c.fd, id, !c.out.empty(), false, false);
+    }
+    return true;
+}
 
-    // Close the server socket when the server shuts down
-    close(server_fd);
+bool LocalServer::write_(uint64_t id, Connection &c) {
+    while (!c.out.empty()) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        c.out.erase(0, n);
+    }
+    // a closed input has nothing left to answer once its responses are out
+    if (c.eof && c.pending == 0 && c.out.empty()) {
+        return false;
+    }
+    // wait for the socket to drain before writing the rest
+    watch(c.fd, id, !c.out.empty(), false, !c.eof);
+    return true;
 }
 
-std::string LocalServer::processSQLCommand(const std::string &command) {
-    return "Server processed command: " + command;
+void LocalServer::close_(uint64_t id) {
+    auto it = _connections.find(id);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    _connections.erase(it);
 }
 
 LocalServer &LocalServer::getInstance() {
     static LocalServer localServer;
     return localServer;
 }
-
-void LocalServer::send_(std::string msg) {
-    send(new_socket, msg.c_str(), msg.size(), 0);
-}